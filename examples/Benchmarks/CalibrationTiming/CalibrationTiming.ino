@@ -0,0 +1,73 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+ /**
+ * @details Times the shifter calibration functions, which use floating
+ *          point math by default or fixed point math if the library is
+ *          built with SIM_RACING_FIXED_POINT set to 1. Prints the time and
+ *          the approximate number of CPU cycles per call over the Serial
+ *          port.
+ * @example CalibrationTiming.ino
+ */
+
+#include <SimRacing.h>
+
+const int Pin_ShifterX = A0;
+const int Pin_ShifterY = A2;
+
+SimRacing::LogitechShifter shifter(Pin_ShifterX, Pin_ShifterY);
+
+const int Iterations = 100;
+
+
+void printResult(const __FlashStringHelper* name, unsigned long elapsed) {
+	const float us = (float) elapsed / Iterations;
+
+	Serial.print(name);
+	Serial.print(F(": "));
+	Serial.print(us);
+	Serial.print(F(" us, ~"));
+	Serial.print((unsigned long) (us * (F_CPU / 1000000UL)));
+	Serial.println(F(" cycles"));
+}
+
+void setup() {
+	Serial.begin(115200);
+	while (!Serial);  // wait for connection to open
+
+	Serial.print(F("Calibration timing, "));
+	Serial.println(SIM_RACING_FIXED_POINT ? F("fixed point") : F("floating point"));
+
+	unsigned long start = micros();
+	for (int i = 0; i < Iterations; ++i) {
+		// vary the neutral position, so that every call does the math
+		shifter.setCalibration(
+			{ 490, (SimRacing::AnalogValue) (440 + (i & 7)) },
+			{ 253, 799 }, { 262, 86 }, { 460, 826 }, { 470, 76 }, { 664, 841 }, { 677, 77 },
+			0.70, 0.50, 0.60);
+	}
+	printResult(F("AnalogShifter::setCalibration()"), micros() - start);
+}
+
+void loop() {
+	// nothing to do
+}
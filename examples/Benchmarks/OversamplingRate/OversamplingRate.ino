@@ -0,0 +1,90 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+ /**
+ * @details Measures the effective sample rate of an analog input for each
+ *          oversampling setting, both with blocking analogRead() calls and
+ *          with the background AnalogSampler. Prints the results over the
+ *          Serial port.
+ * @example OversamplingRate.ino
+ */
+
+#include <SimRacing.h>
+
+const int Pin_Axis = A2;
+
+SimRacing::AnalogInput axis(Pin_Axis);
+
+const unsigned long SampleTime = 1000;  // time to count samples for each setting, in ms
+
+
+// Counts the readings completed with blocking reads, in samples per second
+float blockingRate() {
+	unsigned long count = 0;
+	const unsigned long start = millis();
+	while (millis() - start < SampleTime) {
+		axis.read();
+		count++;
+	}
+	return count * 1000.0 / SampleTime;
+}
+
+// Counts the readings published by the background sampler, in samples per
+// second. With one channel, there is one reading per scan.
+float samplerRate() {
+	SimRacing::AnalogSampler::begin();  // polled, advanced by each read()
+
+	const unsigned long scans = SimRacing::AnalogSampler::getScanCount();
+	const unsigned long start = millis();
+	while (millis() - start < SampleTime) {
+		axis.read();
+	}
+	const unsigned long count = SimRacing::AnalogSampler::getScanCount() - scans;
+
+	SimRacing::AnalogSampler::end();
+	return count * 1000.0 / SampleTime;
+}
+
+
+void setup() {
+	Serial.begin(115200);
+	while (!Serial);  // wait for connection to open
+
+	Serial.println(F("Effective samples per second, by extra bits of resolution"));
+
+	for (uint8_t bits = 0; bits <= SimRacing::AnalogInput::MaxOversampling; ++bits) {
+		axis.setOversampling(bits);
+
+		Serial.print(bits);
+		Serial.print(F(" bits ("));
+		Serial.print(1 << (2 * bits));
+		Serial.print(F(" conversions): blocking "));
+		Serial.print(blockingRate());
+		Serial.print(F("/s, sampler "));
+		Serial.print(samplerRate());
+		Serial.println(F("/s"));
+	}
+}
+
+void loop() {
+	// nothing to do
+}
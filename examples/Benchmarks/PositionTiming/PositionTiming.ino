@@ -0,0 +1,112 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+ /**
+ * @details Times AnalogInput::getPosition(), which rescales using a cached
+ *          fixed-point factor, against rescaling with map() as it did before
+ *          the cache. Prints the average time per call over the Serial port.
+ * @example PositionTiming.ino
+ */
+
+#include <SimRacing.h>
+
+const int Pin_Axis = A2;
+
+SimRacing::AnalogInput axis(Pin_Axis);
+
+const int CallsPerValue = 16;  // calls timed together, as micros() only counts in steps of 4 us on AVR
+volatile long sink;            // keeps the compiler from optimizing away the calls
+
+
+// Rescales the position with map(), following the same steps as
+// getPosition() did without the cache
+long positionWithMap(long rMin, long rMax) {
+	long value = axis.getPositionRaw();
+	long inMin = axis.getMin();
+	long inMax = axis.getMax();
+
+	if (inMin > inMax) {
+		const long temp = inMin;
+		inMin = inMax;
+		inMax = temp;
+		value = inMax - (value - inMin);
+	}
+
+	if (value <= inMin) return rMin;
+	if (value >= inMax) return rMax;
+	return map(value, inMin, inMax, rMin, rMax);
+}
+
+// Times one rescaling method across every ADC value, in us per call
+template<typename Func>
+float timeCalls(Func func) {
+	unsigned long total = 0;
+	long calls = 0;
+
+	for (int value = 0; value <= 1023; ++value) {
+		axis.setPosition(value);
+
+		const unsigned long start = micros();
+		for (int i = 0; i < CallsPerValue; ++i) {
+			sink = func();
+		}
+		total += micros() - start;
+		calls += CallsPerValue;
+	}
+	return (float) total / calls;
+}
+
+void benchmark(long rMin, long rMax) {
+	axis.getPosition(rMin, rMax);  // compute the factor, so it's cached for the timing
+
+	const float overhead = timeCalls([]() -> long { return axis.getPositionRaw(); });
+	const float cached = timeCalls([rMin, rMax]() -> long { return axis.getPosition(rMin, rMax); });
+	const float mapped = timeCalls([rMin, rMax]() -> long { return positionWithMap(rMin, rMax); });
+
+	Serial.print(F("Range "));
+	Serial.print(rMin);
+	Serial.print(F(" to "));
+	Serial.print(rMax);
+	Serial.print(F(": cached "));
+	Serial.print(cached - overhead);
+	Serial.print(F(" us, map() "));
+	Serial.print(mapped - overhead);
+	Serial.println(F(" us"));
+}
+
+
+void setup() {
+	Serial.begin(115200);
+	while (!Serial);  // wait for connection to open
+
+	axis.setCalibration({ 100, 900 });
+
+	Serial.println(F("getPosition() time per call, less loop overhead"));
+	benchmark(0, 1023);
+	benchmark(0, 100);
+	benchmark(-32768, 32767);
+	benchmark(1023, 0);
+}
+
+void loop() {
+	// nothing to do
+}
@@ -0,0 +1,71 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+ /**
+ * @details Prints the inputs of a shift register button box over Serial.
+ * @example ButtonBoxPrint.ino
+ */
+
+#include <SimRacing.h>
+
+// Three 74HC165 shift registers, chained together (24 inputs).
+// The first register's serial input (pin 10) is wired to the second
+// register's output (pin 9), and so on.
+const int Pin_BoxLatch  = 5;  // SH/LD, pin 1 on all registers
+const int Pin_BoxClock  = 6;  // CLK, pin 2 on all registers
+const int Pin_BoxData   = 7;  // QH, pin 9 on the last register
+
+// This pin requires a pull-down resistor! If you have made the proper
+// connections, change the pin number to the one you're using. Setting
+// it will zero data when the button box is disconnected.
+const int Pin_BoxDetect = SimRacing::UnusedPin;
+
+const int NumInputs = 24;
+
+SimRacing::ShiftRegisterInput<NumInputs> buttonBox(
+	Pin_BoxLatch, Pin_BoxClock, Pin_BoxData,
+	Pin_BoxDetect
+);
+
+
+void setup() {
+	buttonBox.begin();
+	buttonBox.setDebounce(3);  // 3 updates in a row to change state
+
+	Serial.begin(115200);
+	while (!Serial);  // wait for connection to open
+
+	Serial.println("Starting...");
+}
+
+void loop() {
+	buttonBox.update();
+
+	// print every input that was pressed or released
+	for (int i = 0; i < NumInputs; i++) {
+		if (buttonBox.getButtonChanged(i)) {
+			Serial.print("Input ");
+			Serial.print(i);
+			Serial.println(buttonBox.getButton(i) ? " pressed" : " released");
+		}
+	}
+}
@@ -0,0 +1,109 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+* @file Bench.h
+* @brief Minimal timing helpers for the host benchmarks
+*
+* Timings are on the host CPU, not on a microcontroller. They're useful for
+* comparing two versions of the same code, not as absolute numbers.
+*/
+
+#ifndef SIM_RACING_HOST_BENCH_H
+#define SIM_RACING_HOST_BENCH_H
+
+#include <HostHAL.h>
+
+#include <stdio.h>
+
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HOST_BENCH_CYCLES 1
+#else
+#define HOST_BENCH_CYCLES 0
+#endif
+
+namespace HostBench {
+
+	/**
+	* @brief Cost of one iteration of a benchmark
+	*/
+	struct Result {
+		double ns;      ///< wall time per iteration, in nanoseconds
+		double cycles;  ///< timestamp counter ticks per iteration, or 0 if unavailable
+	};
+
+	/**
+	* Times a function, taking the fastest of several runs to reject noise
+	* from the rest of the system
+	*
+	* @param func       the function to time, called once per iteration
+	* @param iterations the number of iterations per run
+	* @param runs       the number of runs
+	*
+	* @return the cost of one iteration in the fastest run
+	*/
+	template<typename Func>
+	Result measure(Func func, unsigned long iterations, unsigned int runs = 7) {
+		Result best = { 0.0, 0.0 };
+
+		for (unsigned int r = 0; r < runs; ++r) {
+			const auto start = std::chrono::steady_clock::now();
+#if HOST_BENCH_CYCLES
+			const unsigned long long startCycles = __rdtsc();
+#endif
+			for (unsigned long i = 0; i < iterations; ++i) {
+				func(i);
+			}
+#if HOST_BENCH_CYCLES
+			const unsigned long long cycles = __rdtsc() - startCycles;
+#else
+			const unsigned long long cycles = 0;
+#endif
+			const auto end = std::chrono::steady_clock::now();
+
+			const double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+			if (r == 0 || ns < best.ns) {
+				best.ns = ns;
+				best.cycles = (double) cycles / iterations;
+			}
+		}
+		return best;
+	}
+
+	/** Prints a result as a row of a table */
+	inline void print(const char* name, const Result& result) {
+		printf("  %-40s %9.2f ns %9.1f cycles\n", name, result.ns, result.cycles);
+	}
+
+	/** Keeps the compiler from optimizing away a value */
+	template<typename T>
+	inline void keep(const T& value) {
+		asm volatile("" : : "r,m"(value) : "memory");
+	}
+
+}  // namespace HostBench
+
+#endif
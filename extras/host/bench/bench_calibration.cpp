@@ -0,0 +1,64 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+* Cost of the shifter calibration, with floating point or fixed point math
+* for the thresholds. This is built twice, once against each version of
+* the library (bench_calibration and bench_calibration_fixed).
+*
+* The host has a floating point unit, so the two are close here. On AVR,
+* the float version also pulls in the software floating point library.
+* See examples/Benchmarks/CalibrationTiming for the same timing on a board.
+*/
+
+#include "Bench.h"
+
+#include <SimRacing.h>
+
+using namespace SimRacing;
+
+static const unsigned long Iterations = 100000;
+
+int main() {
+	HostHAL::reset();
+
+	printf("%s point\n", SIM_RACING_FIXED_POINT ? "fixed" : "floating");
+
+	LogitechShifter shifter(A0, A1);
+	const HostBench::Result shifterCal = HostBench::measure([&](unsigned long i) {
+		const AnalogValue wobble = i & 0x7;
+		shifter.setCalibration(
+			{ 490, (AnalogValue) (440 + wobble) },
+			{ 253, 799 }, { 262, 86 }, { 460, 826 }, { 470, 76 }, { 664, 841 }, { 677, 77 },
+			0.70, 0.50, 0.60);
+	}, Iterations);
+	HostBench::print("AnalogShifter::setCalibration()", shifterCal);
+
+	LogitechShifterG25 g25(A0, A1, 10, 15, 14);
+	const HostBench::Result g25Cal = HostBench::measure([&](unsigned long i) {
+		const AnalogValue wobble = i & 0x7;
+		g25.setCalibrationSequential((AnalogValue) (512 + wobble), 900, 100, 0.70, 0.50);
+	}, Iterations);
+	HostBench::print("G25 setCalibrationSequential()", g25Cal);
+
+	return 0;
+}
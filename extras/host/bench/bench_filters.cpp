@@ -0,0 +1,79 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+* Cost of each filter per sample, measured through AnalogInput::read()
+* against the unfiltered read. The difference is the filter itself.
+*/
+
+#include "Bench.h"
+
+#include <SimRacing.h>
+
+using namespace SimRacing;
+
+static const unsigned long Iterations = 1UL << 20;
+
+static HostBench::Result measureFilter(AnalogInput::FilterType type, uint8_t strength) {
+	AnalogInput input(A0);
+	input.setFilter(type, strength);
+
+	// a slow sweep with a little noise, so the median has to sort and
+	// the One Euro filter sees both movement and rest
+	return HostBench::measure([&](unsigned long i) {
+		HostHAL::setAnalog(A0, ((i >> 4) & 0x3FF) ^ (i & 0x3));
+		HostBench::keep(input.read());
+	}, Iterations);
+}
+
+int main() {
+	HostHAL::reset();
+
+	struct Case {
+		const char* name;
+		AnalogInput::FilterType type;
+		uint8_t strength;
+	};
+	const Case cases[] = {
+		{ "none",              AnalogInput::FilterNone,    0 },
+		{ "EMA (1/4)",         AnalogInput::FilterEMA,     2 },
+		{ "EMA (1/128)",       AnalogInput::FilterEMA,     7 },
+		{ "median of 3",       AnalogInput::FilterMedian,  3 },
+		{ "median of 5",       AnalogInput::FilterMedian,  5 },
+		{ "One Euro (1/16)",   AnalogInput::FilterOneEuro, 4 },
+	};
+
+	printf("read() per sample, and the filter's share over 'none'\n");
+
+	const HostBench::Result base = measureFilter(AnalogInput::FilterNone, 0);
+	for (const Case& c : cases) {
+		if (c.type == AnalogInput::FilterNone) {
+			HostBench::print(c.name, base);
+			continue;
+		}
+		const HostBench::Result result = measureFilter(c.type, c.strength);
+		HostBench::print(c.name, result);
+		printf("  %-40s %9.2f ns %9.1f cycles\n", "  filter", result.ns - base.ns, result.cycles - base.cycles);
+	}
+
+	return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+* Compares AnalogInput::getPosition(), which rescales with a cached
+* fixed-point factor, against the map() rescaling it used before.
+*
+* The host has a hardware divider, so the difference here is much smaller
+* than on AVR, where map() calls a software 32-bit division. See
+* examples/Benchmarks/PositionTiming for the same comparison on a board.
+*/
+
+#include "Bench.h"
+
+#include <SimRacing.h>
+
+using namespace SimRacing;
+
+static const unsigned long Iterations = 1UL << 20;
+
+__attribute__((noinline)) static long positionWithMap(const AnalogInput& input, long rMin, long rMax) {
+	long value = input.getPositionRaw();
+	long inMin = input.getMin();
+	long inMax = input.getMax();
+
+	if (inMin > inMax) {
+		const long temp = inMin;
+		inMin = inMax;
+		inMax = temp;
+		value = inMax - (value - inMin);
+	}
+
+	if (value <= inMin) return rMin;
+	if (value >= inMax) return rMax;
+	return map(value, inMin, inMax, rMin, rMax);
+}
+
+static void compare(long rMin, long rMax) {
+	AnalogInput input(A0);
+	input.setCalibration({ 100, 900 });
+
+	printf("range %ld to %ld\n", rMin, rMax);
+
+	const HostBench::Result cached = HostBench::measure([&](unsigned long i) {
+		input.setPosition(i & 0x3FF);
+		HostBench::keep(input.getPosition(rMin, rMax));
+	}, Iterations);
+	HostBench::print("getPosition() (cached factor)", cached);
+
+	const HostBench::Result mapped = HostBench::measure([&](unsigned long i) {
+		input.setPosition(i & 0x3FF);
+		HostBench::keep(positionWithMap(input, rMin, rMax));
+	}, Iterations);
+	HostBench::print("map()", mapped);
+}
+
+int main() {
+	HostHAL::reset();
+
+	compare(0, 1023);
+	compare(0, 100);
+	compare(-32768, 32767);
+
+	return 0;
+}
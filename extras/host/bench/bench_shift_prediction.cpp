@@ -0,0 +1,261 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+* Measures predictive gear engagement (AnalogShifter::setPrediction())
+* against the plain thresholds, by replaying one recorded session through
+* shifters with each setting.
+*
+* The session is a scripted driver at a 1 kHz update rate. Each shift moves
+* the stick across to the column and then into the gear with a minimum-jerk
+* profile, taking 60-200 ms. One in five shifts is aborted: the stick goes
+* past the release point but stops short of the engagement point, and comes
+* back to neutral. Those are the shifts that prediction can get wrong.
+*
+* For each setting this reports:
+*   * the time won: how much sooner the gear was engaged than with the
+*     thresholds alone, averaged over the completed shifts
+*   * false engagements: aborted shifts where a gear was engaged at all,
+*     and completed shifts where a wrong gear was engaged first
+*/
+
+#include "Bench.h"
+
+#include <SimRacing.h>
+#include <TraceReplayer.h>
+
+#include <math.h>
+
+#include <random>
+#include <vector>
+
+using namespace SimRacing;
+
+static const PinNum PinX = A0;
+static const PinNum PinY = A1;
+static const unsigned long UpdateTime = 1000;  // us, 1 kHz
+
+/**
+* @brief One shift in the session
+*/
+struct Shift {
+	int start;                 ///< update the stick starts moving toward the gear
+	int end;                   ///< update the stick is back at neutral
+	Shifter::Gear target;      ///< the gear being shifted into, or 0 if aborted
+};
+
+/**
+* @brief The stick positions for every update of the session
+*/
+struct Session {
+	std::vector<int> x, y;
+	std::vector<Shift> shifts;
+};
+
+/** Minimum-jerk profile, 0-1 over 0-1 */
+static double minJerk(double t) {
+	if (t <= 0.0) return 0.0;
+	if (t >= 1.0) return 1.0;
+	return t * t * t * (10.0 + t * (-15.0 + t * 6.0));
+}
+
+static Session script(int shifts, uint32_t seed) {
+	// stick positions for the Logitech shifter's default calibration
+	const int neutralX = 490, neutralY = 440;
+	const int columnX[] = { 258, 465, 670 };
+	const int topY = 820, bottomY = 80;
+
+	std::mt19937 rng(seed);
+	auto uniform = [&](int lo, int hi) { return lo + (int) (rng() % (hi - lo + 1)); };
+
+	Session s;
+	auto hold = [&](int x, int y, int n) {
+		for (int i = 0; i < n; ++i) { s.x.push_back(x); s.y.push_back(y); }
+	};
+	auto move = [&](int x0, int y0, int x1, int y1, int n) {
+		for (int i = 1; i <= n; ++i) {
+			const double p = minJerk((double) i / n);
+			s.x.push_back((int) lround(x0 + (x1 - x0) * p));
+			s.y.push_back((int) lround(y0 + (y1 - y0) * p));
+		}
+	};
+
+	hold(neutralX, neutralY, 500);
+
+	for (int i = 0; i < shifts; ++i) {
+		const Shifter::Gear gear = (Shifter::Gear) uniform(1, 6);
+		const int x = columnX[(gear - 1) / 2];
+		const int y = (gear % 2) ? topY : bottomY;
+		const bool aborted = (rng() % 5 == 0);
+
+		Shift shift;
+		shift.target = aborted ? 0 : gear;
+
+		// across the gate to the column, then into the gear
+		move(neutralX, neutralY, x, neutralY, uniform(30, 80));
+		shift.start = (int) s.y.size();
+
+		const int duration = uniform(60, 200);
+		if (aborted) {
+			// past the release point (50%), but short of engaging (70%)
+			const double reach = 0.52 + 0.16 * (rng() % 1000) / 1000.0;
+			const int stop = (int) lround(neutralY + (y - neutralY) * reach);
+			move(x, neutralY, x, stop, (int) (duration * reach));
+			hold(x, stop, uniform(0, 40));
+			move(x, stop, x, neutralY, duration);
+		}
+		else {
+			move(x, neutralY, x, y, duration);
+			hold(x, y, uniform(300, 1500));
+			move(x, y, x, neutralY, uniform(60, 200));
+		}
+		move(x, neutralY, neutralX, neutralY, uniform(30, 80));
+		shift.end = (int) s.y.size();
+		hold(neutralX, neutralY, uniform(100, 800));
+
+		s.shifts.push_back(shift);
+	}
+	return s;
+}
+
+/** Records the session as a trace of the library's reads, with noise */
+static MemoryStream record(const Session& session, uint32_t seed) {
+	std::mt19937 rng(seed);
+	auto noise = [&]() { return (int) (rng() % 5) - 2; };
+
+	HostHAL::reset();
+	MemoryStream trace;
+	TraceRecorder recorder(trace);
+	recorder.begin();
+	setTraceHook(&recorder);
+
+	LogitechShifter shifter(PinX, PinY);
+	shifter.begin();
+	for (size_t i = 0; i < session.y.size(); ++i) {
+		HostHAL::setAnalog(PinX, constrain(session.x[i] + noise(), 0, 1023));
+		HostHAL::setAnalog(PinY, constrain(session.y[i] + noise(), 0, 1023));
+		shifter.update();
+		HostHAL::advanceMicros(UpdateTime);
+	}
+	setTraceHook(nullptr);
+
+	printf("session: %zu updates, %zu shifts, trace of %lu bytes\n\n",
+		session.y.size(), session.shifts.size(), recorder.getSize());
+	return trace;
+}
+
+/** Replays the trace with a prediction setting, returning the gear at every update */
+static std::vector<Shifter::Gear> replay(MemoryStream& trace, uint8_t lookahead, AnalogValue speed, size_t updates,
+	unsigned long& predicted, unsigned long& rollbacks)
+{
+	HostHAL::reset();
+	trace.rewind();
+	TraceReplayer replayer(trace);
+	replayer.begin();
+	setTraceHook(&replayer);
+
+	LogitechShifter shifter(PinX, PinY);
+	shifter.setPrediction(lookahead, speed);
+	shifter.begin();
+
+	std::vector<Shifter::Gear> gears;
+	for (size_t i = 0; i < updates; ++i) {
+		shifter.update();
+		gears.push_back(shifter.getGear());
+		HostHAL::advanceMicros(UpdateTime);
+	}
+	setTraceHook(nullptr);
+
+	if (replayer.getMismatches() != 0 || !replayer.done()) {
+		printf("replay diverged from the trace!\n");
+	}
+	predicted = shifter.getPredictedCount();
+	rollbacks = shifter.getRollbackCount();
+	return gears;
+}
+
+/** Finds the first update in a shift with the target gear engaged */
+static int engagedAt(const std::vector<Shifter::Gear>& gears, const Shift& shift) {
+	for (int i = shift.start; i < shift.end; ++i) {
+		if (gears[i] == shift.target) return i;
+	}
+	return -1;
+}
+
+int main() {
+	const Session session = script(1000, 18);
+	MemoryStream trace = record(session, 19);
+	const size_t updates = session.y.size();
+
+	unsigned long predicted = 0, rollbacks = 0;
+	const std::vector<Shifter::Gear> baseline = replay(trace, 0, 0, updates, predicted, rollbacks);
+
+	int completed = 0, aborted = 0;
+	for (const Shift& shift : session.shifts) {
+		if (shift.target == 0) aborted++;
+		else completed++;
+	}
+
+	printf("%9s %6s %10s %10s %14s %14s\n", "lookahead", "speed", "won (ms)", "max (ms)", "false/aborted", "wrong/shifts");
+	printf("%9s %6s %10s %10s %14s %14s\n", "", "", "", "", "(%)", "(%)");
+
+	const uint8_t lookaheads[] = { 0, 2, 5, 10, 20 };
+	const AnalogValue speeds[] = { 0, 2, 8, 16 };  // 0 is the default
+
+	for (uint8_t lookahead : lookaheads) {
+		for (AnalogValue speed : speeds) {
+			if (lookahead == 0 && speed != 0) continue;  // disabled, speed doesn't matter
+
+			const std::vector<Shifter::Gear> gears = replay(trace, lookahead, speed, updates, predicted, rollbacks);
+
+			double won = 0.0;
+			int maxWon = 0, falses = 0, wrong = 0, missed = 0;
+			for (const Shift& shift : session.shifts) {
+				if (shift.target == 0) {
+					for (int i = shift.start; i < shift.end; ++i) {
+						if (gears[i] != 0) { falses++; break; }
+					}
+					continue;
+				}
+
+				const int at = engagedAt(gears, shift);
+				const int base = engagedAt(baseline, shift);
+				if (at < 0 || base < 0) { missed++; continue; }
+
+				const int gained = base - at;  // updates, at 1 ms each
+				won += gained;
+				if (gained > maxWon) maxWon = gained;
+
+				for (int i = shift.start; i < at; ++i) {
+					if (gears[i] != 0) { wrong++; break; }
+				}
+			}
+
+			printf("%9u %6s %10.2f %10d %14.1f %14.1f",
+				lookahead, (speed == 0) ? "def" : std::to_string(speed).c_str(),
+				won / completed, maxWon, 100.0 * falses / aborted, 100.0 * wrong / completed);
+			if (missed) printf("  (%d shifts never engaged)", missed);
+			printf("\n");
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+* Compares the cost of update() called through the Peripheral base class
+* (virtual) against the StaticPeripheral wrapper (direct).
+*
+* The wrapper saves the one indirect call from update() to updateState().
+* Everything within updateState() is compiled into the library either way.
+*/
+
+#include "Bench.h"
+
+#include <SimRacing.h>
+
+using namespace SimRacing;
+
+static const unsigned long Iterations = 200000;
+
+template<class Device, typename... Args>
+static void compare(const char* name, Args... args) {
+	Device plain(args...);
+	StaticPeripheral<Device> wrapped(args...);
+	plain.begin();
+	wrapped.begin();
+
+	// through a volatile pointer, so the compiler can't see the
+	// dynamic type and skip the virtual call
+	Peripheral* volatile pointer = &plain;
+	Peripheral& base = *pointer;
+
+	printf("%s\n", name);
+
+	const HostBench::Result virt = HostBench::measure([&](unsigned long i) {
+		HostHAL::setAnalog(A0, i & 0x3FF);
+		HostBench::keep(base.update());
+	}, Iterations);
+	HostBench::print("Peripheral& update() (virtual)", virt);
+
+	const HostBench::Result stat = HostBench::measure([&](unsigned long i) {
+		HostHAL::setAnalog(A0, i & 0x3FF);
+		HostBench::keep(wrapped.update());
+	}, Iterations);
+	HostBench::print("StaticPeripheral update()", stat);
+
+	printf("  %-40s %9.2f ns %9.1f cycles\n", "difference", virt.ns - stat.ns, virt.cycles - stat.cycles);
+}
+
+int main() {
+	HostHAL::reset();
+
+	compare<Handbrake>("Handbrake", A0);
+	compare<LogitechPedals>("LogitechPedals", A0, A1, A2);
+	compare<LogitechShifter>("LogitechShifter", A0, A1, 2);
+
+	return 0;
+}
@@ -0,0 +1,218 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+* @file Arduino.h
+* @brief Stand-in for the Arduino core, so the library can be built and run
+*        natively on a host machine for testing and benchmarking
+*
+* Only the parts of the core API that the library uses are provided. Pin
+* states, the ADC, and the clock are all simulated, and are scripted by the
+* test through HostHAL.h. The pin numbering follows the Arduino Leonardo.
+*/
+
+#ifndef SIM_RACING_HOST_ARDUINO_H
+#define SIM_RACING_HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <string>
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define NUM_DIGITAL_PINS 31
+#define NUM_ANALOG_INPUTS 12
+
+#define PIN_A0  18
+#define PIN_A1  19
+#define PIN_A2  20
+#define PIN_A3  21
+#define PIN_A4  22
+#define PIN_A5  23
+
+static const uint8_t A0 = PIN_A0;
+static const uint8_t A1 = PIN_A1;
+static const uint8_t A2 = PIN_A2;
+static const uint8_t A3 = PIN_A3;
+static const uint8_t A4 = PIN_A4;
+static const uint8_t A5 = PIN_A5;
+
+// hardware SPI pins, as on the Leonardo's ICSP header
+#define PIN_SPI_MISO 14
+#define PIN_SPI_SCK  15
+#define PIN_SPI_MOSI 16
+
+#define NOT_AN_INTERRUPT -1
+#define digitalPinToInterrupt(p) ((p) < NUM_DIGITAL_PINS ? (int)(p) : NOT_AN_INTERRUPT)
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t val);
+int analogRead(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void noInterrupts();
+void interrupts();
+void attachInterrupt(int irq, void (*isr)(), int mode);
+void detachInterrupt(int irq);
+
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+template<typename T, typename L, typename H>
+auto constrain(T x, L low, H high) -> decltype(x + low + high) {
+	return (x < low) ? low : ((x > high) ? high : x);
+}
+
+class __FlashStringHelper;
+#define F(str) (reinterpret_cast<const __FlashStringHelper*>(str))
+
+
+/**
+* @brief Minimal Arduino String, backed by std::string
+*/
+class String {
+public:
+	String(const char* str = "") : data(str) {}
+	String(const __FlashStringHelper* str) : data(reinterpret_cast<const char*>(str)) {}
+	String(char c) : data(1, c) {}
+	String(int value) : data(std::to_string(value)) {}
+	String(unsigned int value) : data(std::to_string(value)) {}
+	String(long value) : data(std::to_string(value)) {}
+	String(unsigned long value) : data(std::to_string(value)) {}
+
+	unsigned int length() const { return data.length(); }
+	const char* c_str() const { return data.c_str(); }
+	char charAt(unsigned int i) const { return (i < data.length()) ? data[i] : 0; }
+	char operator[](unsigned int i) const { return charAt(i); }
+
+	String& operator+=(const String& other) { data += other.data; return *this; }
+	friend String operator+(String lhs, const String& rhs) { return lhs += rhs; }
+	bool operator==(const String& other) const { return data == other.data; }
+	bool operator!=(const String& other) const { return data != other.data; }
+
+	void trim();
+	void toLowerCase();
+	void toUpperCase();
+	long toInt() const { return atol(data.c_str()); }
+	float toFloat() const { return (float) atof(data.c_str()); }
+
+private:
+	std::string data;
+};
+
+
+/**
+* @brief Output interface, as in the Arduino core. Everything printed goes
+*        through write(uint8_t).
+*/
+class Print {
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) = 0;
+	size_t write(const char* str);
+
+	size_t print(const char* str) { return write(str); }
+	size_t print(const __FlashStringHelper* str) { return write(reinterpret_cast<const char*>(str)); }
+	size_t print(const String& str) { return write(str.c_str()); }
+	size_t print(char c) { return write((uint8_t) c); }
+	size_t print(unsigned char value, int base = 10) { return print((unsigned long) value, base); }
+	size_t print(int value, int base = 10) { return print((long) value, base); }
+	size_t print(unsigned int value, int base = 10) { return print((unsigned long) value, base); }
+	size_t print(long value, int base = 10);
+	size_t print(unsigned long value, int base = 10);
+	size_t print(double value, int digits = 2);
+
+	template<typename T>
+	size_t println(const T& value) { const size_t n = print(value); return n + println(); }
+	template<typename T>
+	size_t println(const T& value, int format) { const size_t n = print(value, format); return n + println(); }
+	size_t println() { return write("\r\n"); }
+};
+
+
+/**
+* @brief Input and output interface, as in the Arduino core
+*/
+class Stream : public Print {
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+
+	void setTimeout(unsigned long ms) { timeout = ms; }
+	String readStringUntil(char terminator);
+	float parseFloat();
+
+protected:
+	unsigned long timeout = 1000;  ///< ignored, as there's no one to wait for on the host
+};
+
+
+/**
+* @brief Serial port stand-in. Input is queued by the test, and output is
+*        buffered so that it can be checked.
+*/
+class HostSerial : public Stream {
+public:
+	void begin(unsigned long) {}
+	operator bool() const { return true; }
+
+	size_t write(uint8_t c) override { output += (char) c; return 1; }
+	using Print::write;
+
+	int available() override { return (int) (input.size() - pos); }
+	int read() override { return (pos < input.size()) ? (uint8_t) input[pos++] : -1; }
+	int peek() override { return (pos < input.size()) ? (uint8_t) input[pos] : -1; }
+
+	/** Queues data to be read from the port */
+	void send(const char* str) { input.erase(0, pos); pos = 0; input += str; }
+
+	std::string output;  ///< everything written to the port
+
+private:
+	std::string input;
+	size_t pos = 0;
+};
+
+extern HostSerial Serial;
+
+#endif
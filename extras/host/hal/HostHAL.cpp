@@ -0,0 +1,430 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "HostHAL.h"
+
+#include <SPI.h>
+
+#include <ctype.h>
+
+HostSerial Serial;
+SPIClass SPI;
+
+namespace {
+
+	struct PinState {
+		uint8_t mode = INPUT;
+		bool output = LOW;      // level written with digitalWrite()
+		bool input = LOW;       // level driven from outside
+		bool driven = false;    // whether 'input' has been set by the test
+
+		int analogValue = 0;
+		std::function<int()> analogSource;
+
+		void (*isr)() = nullptr;
+		int isrMode = CHANGE;
+		bool isrPending = false;
+	};
+
+	struct ShiftRegisterChain {
+		bool attached = false;
+		uint8_t pinLatch = 0;
+		uint8_t pinClock = 0;
+		uint8_t pinData = 0;
+		bool fill = LOW;
+
+		std::vector<uint8_t> inputs;  // parallel inputs, as set by the test
+		std::vector<uint8_t> loaded;  // contents of the registers
+		size_t position = 0;          // index of the bit on the output
+
+		unsigned long latches = 0;
+
+		void load() {
+			this->loaded = this->inputs;
+			this->position = 0;
+		}
+
+		bool output() const {
+			if (this->position >= this->loaded.size() * 8) return this->fill;
+			const uint8_t byte = this->loaded[this->position / 8];
+			return byte & (0x80 >> (this->position % 8));
+		}
+	};
+
+	PinState pins[NUM_DIGITAL_PINS];
+	ShiftRegisterChain chain;
+
+	unsigned long nowMicros = 0;
+	unsigned long analogReads = 0;
+	unsigned long analogReadTime = 0;
+
+	bool interruptsEnabled = true;
+
+	PinState* getPin(uint8_t pin) {
+		if (pin >= NUM_DIGITAL_PINS) return nullptr;
+		return &pins[pin];
+	}
+
+	bool readLevel(uint8_t pin) {
+		const PinState* p = getPin(pin);
+		if (p == nullptr) return LOW;
+
+		if (chain.attached && pin == chain.pinData) return chain.output();
+		if (p->mode == OUTPUT) return p->output;
+		if (p->driven) return p->input;
+
+		// floating inputs read high if the pull-up is on, low otherwise
+		return (p->mode == INPUT_PULLUP) || (p->mode == INPUT && p->output == HIGH);
+	}
+
+	void runInterrupt(PinState& p) {
+		if (p.isr == nullptr) return;
+		if (!interruptsEnabled) {
+			p.isrPending = true;
+			return;
+		}
+		p.isrPending = false;
+		p.isr();
+	}
+
+	void setLevel(uint8_t pin, bool& level, bool state) {
+		const bool before = readLevel(pin);
+		level = state;
+		const bool after = readLevel(pin);
+
+		if (before == after) return;
+
+		PinState& p = pins[pin];
+		if (p.isrMode == CHANGE
+			|| (p.isrMode == RISING && after == HIGH)
+			|| (p.isrMode == FALLING && after == LOW))
+		{
+			runInterrupt(p);
+		}
+
+		if (!chain.attached) return;
+
+		// latch is active low, loading the registers
+		if (pin == chain.pinLatch && after == LOW) {
+			chain.load();
+			chain.latches++;
+		}
+		// registers shift on the rising edge of the clock
+		// while the latch is high
+		else if (pin == chain.pinClock && after == HIGH && readLevel(chain.pinLatch) == HIGH) {
+			chain.position++;
+		}
+	}
+
+}  // namespace
+
+
+//#########################################################
+//                     Host Controls                      #
+//#########################################################
+
+void HostHAL::reset() {
+	for (uint8_t i = 0; i < NUM_DIGITAL_PINS; ++i) {
+		pins[i] = PinState();
+	}
+	chain = ShiftRegisterChain();
+
+	nowMicros = 0;
+	analogReads = 0;
+	analogReadTime = 0;
+	interruptsEnabled = true;
+
+	Serial = HostSerial();
+	SPI = SPIClass();
+}
+
+void HostHAL::setAnalog(uint8_t pin, int value) {
+	PinState* p = getPin(pin);
+	if (p == nullptr) return;
+	p->analogValue = value;
+	p->analogSource = nullptr;
+}
+
+void HostHAL::setAnalogSource(uint8_t pin, std::function<int()> source) {
+	PinState* p = getPin(pin);
+	if (p == nullptr) return;
+	p->analogSource = source;
+}
+
+unsigned long HostHAL::getAnalogReads() {
+	return analogReads;
+}
+
+void HostHAL::setAnalogReadTime(unsigned long us) {
+	analogReadTime = us;
+}
+
+void HostHAL::setDigital(uint8_t pin, bool level) {
+	PinState* p = getPin(pin);
+	if (p == nullptr) return;
+	p->driven = true;
+	setLevel(pin, p->input, level);
+}
+
+bool HostHAL::getOutput(uint8_t pin) {
+	const PinState* p = getPin(pin);
+	return (p != nullptr) ? p->output : LOW;
+}
+
+uint8_t HostHAL::getMode(uint8_t pin) {
+	const PinState* p = getPin(pin);
+	return (p != nullptr) ? p->mode : INPUT;
+}
+
+void HostHAL::setMicros(unsigned long us) {
+	nowMicros = us;
+}
+
+void HostHAL::advanceMicros(unsigned long us) {
+	nowMicros += us;
+}
+
+void HostHAL::advanceMillis(unsigned long ms) {
+	nowMicros += ms * 1000;
+}
+
+void HostHAL::attachShiftRegisters(uint8_t pinLatch, uint8_t pinClock, uint8_t pinData, bool fill) {
+	chain.attached = true;
+	chain.pinLatch = pinLatch;
+	chain.pinClock = pinClock;
+	chain.pinData = pinData;
+	chain.fill = fill;
+	chain.position = 0;
+}
+
+void HostHAL::detachShiftRegisters() {
+	chain.attached = false;
+}
+
+void HostHAL::setShiftRegisters(const std::vector<uint8_t>& data) {
+	chain.inputs = data;
+	if (chain.attached && readLevel(chain.pinLatch) == LOW) chain.load();
+}
+
+unsigned long HostHAL::getShiftRegisterLatches() {
+	return chain.latches;
+}
+
+
+//#########################################################
+//                      Arduino Core                      #
+//#########################################################
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	PinState* p = getPin(pin);
+	if (p == nullptr) return;
+
+	p->mode = mode;
+
+	// as on the AVR, the output register doubles as the pull-up
+	if (mode == INPUT_PULLUP) p->output = HIGH;
+}
+
+int digitalRead(uint8_t pin) {
+	return readLevel(pin);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+	PinState* p = getPin(pin);
+	if (p == nullptr) return;
+	setLevel(pin, p->output, val != LOW);
+}
+
+int analogRead(uint8_t pin) {
+	if (pin < A0) pin += A0;  // channel numbers to pin numbers
+	PinState* p = getPin(pin);
+	if (p == nullptr) return 0;
+
+	analogReads++;
+	nowMicros += analogReadTime;
+
+	const int value = p->analogSource ? p->analogSource() : p->analogValue;
+	return constrain(value, 0, 1023);
+}
+
+unsigned long millis() {
+	return nowMicros / 1000;
+}
+
+unsigned long micros() {
+	return nowMicros;
+}
+
+void delay(unsigned long ms) {
+	nowMicros += ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us) {
+	nowMicros += us;
+}
+
+void noInterrupts() {
+	interruptsEnabled = false;
+}
+
+void interrupts() {
+	interruptsEnabled = true;
+	for (uint8_t i = 0; i < NUM_DIGITAL_PINS; ++i) {
+		if (pins[i].isrPending) runInterrupt(pins[i]);
+	}
+}
+
+void attachInterrupt(int irq, void (*isr)(), int mode) {
+	if (irq < 0 || irq >= NUM_DIGITAL_PINS) return;
+	pins[irq].isr = isr;
+	pins[irq].isrMode = mode;
+	pins[irq].isrPending = false;
+}
+
+void detachInterrupt(int irq) {
+	if (irq < 0 || irq >= NUM_DIGITAL_PINS) return;
+	pins[irq].isr = nullptr;
+	pins[irq].isrPending = false;
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+	return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+
+//#########################################################
+//                    String and Stream                   #
+//#########################################################
+
+void String::trim() {
+	size_t start = 0;
+	while (start < this->data.size() && isspace((unsigned char) this->data[start])) start++;
+	size_t end = this->data.size();
+	while (end > start && isspace((unsigned char) this->data[end - 1])) end--;
+	this->data = this->data.substr(start, end - start);
+}
+
+void String::toLowerCase() {
+	for (char& c : this->data) c = (char) tolower((unsigned char) c);
+}
+
+void String::toUpperCase() {
+	for (char& c : this->data) c = (char) toupper((unsigned char) c);
+}
+
+size_t Print::write(const char* str) {
+	size_t n = 0;
+	while (*str) n += this->write((uint8_t) *str++);
+	return n;
+}
+
+size_t Print::print(long value, int base) {
+	if (base == 10 && value < 0) {
+		return this->write((uint8_t) '-') + this->print((unsigned long) -value, base);
+	}
+	return this->print((unsigned long) value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+	if (base < 2) base = 10;
+
+	char buffer[8 * sizeof(long) + 1];
+	char* str = &buffer[sizeof(buffer) - 1];
+	*str = '\0';
+
+	do {
+		const char c = (char) (value % base);
+		value /= base;
+		*--str = (c < 10) ? (c + '0') : (c + 'A' - 10);
+	} while (value);
+
+	return this->write(str);
+}
+
+size_t Print::print(double value, int digits) {
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+	return this->write(buffer);
+}
+
+String Stream::readStringUntil(char terminator) {
+	String out;
+	int c;
+	while ((c = this->read()) >= 0 && c != terminator) {
+		out += (char) c;
+	}
+	return out;
+}
+
+float Stream::parseFloat() {
+	// skip anything that can't start a number
+	int c;
+	while ((c = this->peek()) >= 0 && !(isdigit(c) || c == '-' || c == '.')) {
+		this->read();
+	}
+	if (c < 0) return 0.0f;
+
+	String text;
+	while ((c = this->peek()) >= 0 && (isdigit(c) || c == '-' || c == '.')) {
+		text += (char) this->read();
+	}
+	return text.toFloat();
+}
+
+
+//#########################################################
+//                          SPI                           #
+//#########################################################
+
+void SPIClass::begin() {
+	pinMode(PIN_SPI_SCK, OUTPUT);
+	pinMode(PIN_SPI_MOSI, OUTPUT);
+	pinMode(PIN_SPI_MISO, INPUT);
+	digitalWrite(PIN_SPI_SCK, LOW);
+}
+
+void SPIClass::end() {
+	this->active = false;
+}
+
+void SPIClass::beginTransaction(SPISettings settings) {
+	this->settings = settings;
+	this->active = true;
+}
+
+void SPIClass::endTransaction() {
+	this->active = false;
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+	// mode 0: data is sampled on the rising edge, clock idles low
+	uint8_t in = 0x00;
+	for (uint8_t bit = 0; bit < 8; ++bit) {
+		const uint8_t mask = (this->settings.bitOrder == MSBFIRST) ? (0x80 >> bit) : (0x01 << bit);
+		digitalWrite(PIN_SPI_MOSI, (data & mask) ? HIGH : LOW);
+		if (digitalRead(PIN_SPI_MISO)) in |= mask;
+		digitalWrite(PIN_SPI_SCK, HIGH);
+		digitalWrite(PIN_SPI_SCK, LOW);
+	}
+	return in;
+}
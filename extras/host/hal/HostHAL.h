@@ -0,0 +1,113 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+* @file HostHAL.h
+* @brief Controls for the simulated hardware behind the host Arduino core
+*
+* Tests use these functions to set what the library "sees" on its pins and
+* to move the clock. Each test should call HostHAL::reset() first.
+*/
+
+#ifndef SIM_RACING_HOST_HAL_H
+#define SIM_RACING_HOST_HAL_H
+
+#include <Arduino.h>
+
+#include <functional>
+#include <vector>
+
+namespace HostHAL {
+
+	/** Returns every pin, the clock, the serial port, and the shift registers to power-on defaults */
+	void reset();
+
+
+	/** Sets the value returned by analogRead() for a pin (0-1023) */
+	void setAnalog(uint8_t pin, int value);
+
+	/** Sets a function to generate the value returned by analogRead() for a pin */
+	void setAnalogSource(uint8_t pin, std::function<int()> source);
+
+	/** Returns the number of times analogRead() has been called since reset */
+	unsigned long getAnalogReads();
+
+	/**
+	* Sets the simulated ADC conversion time. The clock advances by this
+	* amount on every analogRead() call. Defaults to 0.
+	*/
+	void setAnalogReadTime(unsigned long us);
+
+
+	/**
+	* Sets the level of an externally driven pin. If an interrupt is
+	* attached to the pin it fires on the change (or once interrupts are
+	* enabled again).
+	*/
+	void setDigital(uint8_t pin, bool level);
+
+	/** Returns the level last written to a pin with digitalWrite() */
+	bool getOutput(uint8_t pin);
+
+	/** Returns the mode last set for a pin with pinMode() */
+	uint8_t getMode(uint8_t pin);
+
+
+	/** Sets the microsecond clock */
+	void setMicros(unsigned long us);
+
+	/** Moves the microsecond clock forwards */
+	void advanceMicros(unsigned long us);
+
+	/** Moves the microsecond clock forwards, in milliseconds */
+	void advanceMillis(unsigned long ms);
+
+
+	/**
+	* Attaches a chain of parallel-in serial-out shift registers (74HC165) to
+	* a set of pins. The chain loads while the latch pin is low and shifts out
+	* one bit, MSB-first, on every rising edge of the clock pin. Bits past the
+	* end of the chain read as the 'fill' level.
+	*
+	* @param pinLatch the pin connected to the registers' latch (PL)
+	* @param pinClock the pin connected to the registers' clock (CP)
+	* @param pinData  the pin connected to the last register's output (Q7)
+	* @param fill     the level read once all of the data is shifted out
+	*/
+	void attachShiftRegisters(uint8_t pinLatch, uint8_t pinClock, uint8_t pinData, bool fill = LOW);
+
+	/** Removes the shift register chain, leaving the data pin as a plain input */
+	void detachShiftRegisters();
+
+	/**
+	* Sets the parallel inputs of the shift register chain. The first byte is
+	* the first to be shifted out.
+	*/
+	void setShiftRegisters(const std::vector<uint8_t>& data);
+
+	/** Returns the number of times the shift register chain has been latched since reset */
+	unsigned long getShiftRegisterLatches();
+
+}  // namespace HostHAL
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "HostTest.h"
+
+#include <vector>
+
+namespace {
+
+	struct TestEntry {
+		const char* name;
+		HostTest::TestFunction func;
+	};
+
+	std::vector<TestEntry>& getTests() {
+		static std::vector<TestEntry> tests;  // constructed on first use, for static registration
+		return tests;
+	}
+
+	unsigned int failures = 0;  // failed checks in the current test
+
+}  // namespace
+
+HostTest::Registrar::Registrar(const char* name, TestFunction func) {
+	getTests().push_back({ name, func });
+}
+
+void HostTest::fail(const char* file, int line, const char* expr) {
+	printf("  %s:%d: check failed: %s\n", file, line, expr);
+	failures++;
+}
+
+void HostTest::failEqual(const char* file, int line, const char* expr, long long expected, long long actual) {
+	printf("  %s:%d: %s == %lld, expected %lld\n", file, line, expr, actual, expected);
+	failures++;
+}
+
+int HostTest::runAll() {
+	int failed = 0;
+
+	for (const TestEntry& test : getTests()) {
+		HostHAL::reset();
+		failures = 0;
+
+		test.func();
+
+		printf("[%s] %s\n", failures ? "FAIL" : " OK ", test.name);
+		if (failures) failed++;
+	}
+
+	printf("%u tests, %d failed\n", (unsigned int) getTests().size(), failed);
+	return failed;
+}
+
+int main() {
+	return HostTest::runAll() ? 1 : 0;
+}
@@ -0,0 +1,80 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+* @file HostTest.h
+* @brief Minimal unit test runner for the host build
+*
+* Tests are declared with TEST_CASE() and are run in the order they are
+* declared. The simulated hardware is reset before each one.
+*/
+
+#ifndef SIM_RACING_HOST_TEST_H
+#define SIM_RACING_HOST_TEST_H
+
+#include <HostHAL.h>
+
+#include <stdio.h>
+
+namespace HostTest {
+
+	typedef void (*TestFunction)();
+
+	/** Adds a test to the list to run */
+	struct Registrar {
+		Registrar(const char* name, TestFunction func);
+	};
+
+	/** Records a failed check for the current test */
+	void fail(const char* file, int line, const char* expr);
+
+	/** Records a failed comparison for the current test */
+	void failEqual(const char* file, int line, const char* expr, long long expected, long long actual);
+
+	/** Runs every registered test, returning the number that failed */
+	int runAll();
+
+}  // namespace HostTest
+
+#define HOST_TEST_CONCAT_(a, b) a ## b
+#define HOST_TEST_CONCAT(a, b) HOST_TEST_CONCAT_(a, b)
+
+/** Declares a test case, to be followed by the body of the test */
+#define TEST_CASE(name) \
+	static void name(); \
+	static HostTest::Registrar HOST_TEST_CONCAT(registrar_, name)(#name, name); \
+	static void name()
+
+/** Fails the test if the condition is false, and continues */
+#define CHECK(cond) \
+	do { if (!(cond)) HostTest::fail(__FILE__, __LINE__, #cond); } while (0)
+
+/** Fails the test if the values don't match, printing both, and continues */
+#define CHECK_EQUAL(expected, actual) \
+	do { \
+		const long long e_ = (long long) (expected); \
+		const long long a_ = (long long) (actual); \
+		if (e_ != a_) HostTest::failEqual(__FILE__, __LINE__, #actual, e_, a_); \
+	} while (0)
+
+#endif
@@ -0,0 +1,401 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "HostTest.h"
+
+#include <SimRacing.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+using namespace SimRacing;
+
+static const PinNum PinAxis = A0;
+
+/** Reference rescaling, using the Arduino map() function with range limits */
+static long mapLimited(long value, long inMin, long inMax, long outMin, long outMax) {
+	if (inMin > inMax) {
+		value = inMax + inMin - value;  // invert
+		const long temp = inMin;
+		inMin = inMax;
+		inMax = temp;
+	}
+	if (value <= inMin) return outMin;
+	if (value >= inMax) return outMax;
+	return map(value, inMin, inMax, outMin, outMax);
+}
+
+
+TEST_CASE(read_reports_changes) {
+	AnalogInput input(PinAxis);
+
+	HostHAL::setAnalog(PinAxis, 512);
+	CHECK(input.read());
+	CHECK_EQUAL(512, input.getPositionRaw());
+	CHECK_EQUAL(512, input.getPosition());
+
+	CHECK(!input.read());  // no change
+
+	HostHAL::setAnalog(PinAxis, 513);
+	CHECK(input.read());
+	CHECK_EQUAL(513, input.getPositionRaw());
+}
+
+TEST_CASE(read_ignores_changes_past_range) {
+	AnalogInput input(PinAxis);
+	input.setCalibration({ 100, 900 });
+
+	HostHAL::setAnalog(PinAxis, 950);
+	CHECK(input.read());
+
+	// still past the max, so the output doesn't change
+	HostHAL::setAnalog(PinAxis, 960);
+	CHECK(!input.read());
+	CHECK_EQUAL(AnalogInput::Max, input.getPosition());
+
+	// from one extreme to the other
+	HostHAL::setAnalog(PinAxis, 10);
+	CHECK(input.read());
+	CHECK_EQUAL(AnalogInput::Min, input.getPosition());
+}
+
+TEST_CASE(unused_pin_never_reads) {
+	AnalogInput input(UnusedPin);
+	CHECK(!input.read());
+	CHECK_EQUAL(0, HostHAL::getAnalogReads());
+}
+
+TEST_CASE(position_matches_map) {
+	const AnalogInput::Calibration cals[] = {
+		{ 0, 1023 }, { 100, 900 }, { 900, 100 }, { 511, 512 }, { 300, 300 },
+	};
+	const long ranges[][2] = {
+		{ 0, 1023 }, { 0, 255 }, { -32768, 32767 }, { 1000, 0 }, { 0, 100000 },
+	};
+
+	AnalogInput input(PinAxis);
+
+	for (const AnalogInput::Calibration& cal : cals) {
+		input.setCalibration(cal);
+
+		for (AnalogValue value = 0; value <= 1023; ++value) {
+			input.setPosition(value);
+
+			for (const auto& range : ranges) {
+				const long expected = mapLimited(value, cal.min, cal.max, range[0], range[1]);
+				CHECK_EQUAL(expected, input.getPosition(range[0], range[1]));
+			}
+		}
+	}
+}
+
+TEST_CASE(position_matches_map_exhaustive) {
+	// every input value across the full oversampled range, against
+	// calibrations at and around the edges and a spread of output ranges,
+	// including ones too large for the fixed-point factor
+	const long top = (long) AnalogInput::Max << AnalogInput::MaxOversampling;
+
+	std::vector<AnalogInput::Calibration> cals = {
+		{ 0, 1023 }, { 1023, 0 }, { 0, 1 }, { 1, 0 }, { 0, 2 }, { 2, 0 },
+		{ 0, (AnalogValue) top }, { (AnalogValue) top, 0 }, { 5, 6 }, { 1000, 998 },
+	};
+	srand(6);
+	for (int i = 0; i < 20; ++i) {
+		cals.push_back({ (AnalogValue) (rand() % (top + 1)), (AnalogValue) (rand() % (top + 1)) });
+	}
+
+	std::vector<std::pair<long, long>> ranges;
+	for (long r = -40; r <= 40; ++r) ranges.push_back({ 0, r });
+	const long wide[][2] = {
+		{ 0, 100 }, { 100, 0 }, { -50, 50 }, { 0, 1023 }, { 0, 65535 }, { -32768, 32767 },
+		{ 0, 100000 }, { 0, (1L << 20) }, { 0, (1L << 24) - 1 }, { 0, (1L << 30) },
+		{ -1000000000L, 1000000000L }, { 2000000000L, -2000000000L },
+	};
+	for (const auto& range : wide) ranges.push_back({ range[0], range[1] });
+
+	AnalogInput input(PinAxis);
+	unsigned long failures = 0;
+
+	for (const auto& range : ranges) {
+		for (const AnalogInput::Calibration& cal : cals) {
+			input.setCalibration(cal);
+
+			for (long value = 0; value <= top; ++value) {
+				input.setPosition(value);
+				const long expected = mapLimited(value, cal.min, cal.max, range.first, range.second);
+				if (input.getPosition(range.first, range.second) != expected) failures++;
+			}
+		}
+	}
+	CHECK_EQUAL(0UL, failures);
+}
+
+TEST_CASE(inverted_axis) {
+	AnalogInput input(PinAxis);
+	input.setCalibration({ 100, 900 });
+	CHECK(!input.isInverted());
+
+	input.setInverted();
+	CHECK(input.isInverted());
+	CHECK_EQUAL(900, input.getMin());
+	CHECK_EQUAL(100, input.getMax());
+
+	HostHAL::setAnalog(PinAxis, 100);
+	input.read();
+	CHECK_EQUAL(AnalogInput::Max, input.getPosition());
+
+	HostHAL::setAnalog(PinAxis, 900);
+	input.read();
+	CHECK_EQUAL(AnalogInput::Min, input.getPosition());
+}
+
+TEST_CASE(oversampling_scales_readings) {
+	AnalogInput input(PinAxis);
+	input.setCalibration({ 100, 900 });
+	HostHAL::setAnalog(PinAxis, 512);
+
+	input.setOversampling(2);
+	CHECK_EQUAL(2, input.getOversampling());
+	CHECK_EQUAL(400, input.getMin());
+	CHECK_EQUAL(3600, input.getMax());
+
+	const unsigned long before = HostHAL::getAnalogReads();
+	input.read();
+	CHECK_EQUAL(16, HostHAL::getAnalogReads() - before);  // 4^2 conversions
+	CHECK_EQUAL(2048, input.getPositionRaw());
+
+	// back down, with the calibration restored
+	input.setOversampling(0);
+	CHECK_EQUAL(100, input.getMin());
+	CHECK_EQUAL(900, input.getMax());
+	CHECK_EQUAL(512, input.getPositionRaw());
+
+	input.setOversampling(99);
+	CHECK_EQUAL(AnalogInput::MaxOversampling, input.getOversampling());
+}
+
+TEST_CASE(oversampling_read_time) {
+	// blocking reads at ~110 us per conversion, as analogRead() on AVR
+	const unsigned long Conversion = 110;
+	HostHAL::setAnalogReadTime(Conversion);
+
+	AnalogInput input(PinAxis);
+	HostHAL::setAnalog(PinAxis, 512);
+
+	for (uint8_t bits = 0; bits <= AnalogInput::MaxOversampling; ++bits) {
+		input.setOversampling(bits);
+
+		const unsigned long start = micros();
+		const int Readings = 10;
+		for (int i = 0; i < Readings; ++i) input.read();
+		const unsigned long perReading = (micros() - start) / Readings;
+
+		// 4^bits conversions per reading: 0.11, 0.44, 1.76, and 7.04 ms
+		CHECK_EQUAL(Conversion << (2 * bits), perReading);
+	}
+}
+
+TEST_CASE(deadband_suppresses_small_changes) {
+	AnalogInput input(PinAxis);
+	input.setDeadband(5);
+
+	HostHAL::setAnalog(PinAxis, 500);
+	CHECK(input.read());
+
+	HostHAL::setAnalog(PinAxis, 505);
+	CHECK(!input.read());
+	CHECK_EQUAL(1, input.getSuppressedCount());
+	CHECK_EQUAL(505, input.getPositionRaw());  // the position still follows
+
+	HostHAL::setAnalog(PinAxis, 506);
+	CHECK(input.read());  // measured from the last reported position
+
+	// the ends of the range are always reported
+	HostHAL::setAnalog(PinAxis, AnalogInput::Max - 1);
+	CHECK(input.read());
+	HostHAL::setAnalog(PinAxis, AnalogInput::Max);
+	CHECK(input.read());
+}
+
+TEST_CASE(filters_settle_on_constant_input) {
+	const AnalogInput::FilterType types[] = {
+		AnalogInput::FilterNone, AnalogInput::FilterEMA, AnalogInput::FilterMedian, AnalogInput::FilterOneEuro,
+	};
+
+	for (AnalogInput::FilterType type : types) {
+		AnalogInput input(PinAxis);
+		input.setFilter(type);
+		CHECK_EQUAL(type, input.getFilter());
+
+		HostHAL::setAnalog(PinAxis, 700);
+		for (int i = 0; i < 200; ++i) input.read();
+		CHECK_EQUAL(700, input.getPositionRaw());
+	}
+}
+
+/** Feeds one reading through the input's filter, returning the position */
+static AnalogValue filterStep(AnalogInput& input, AnalogValue value) {
+	HostHAL::setAnalog(PinAxis, value);
+	input.read();
+	return input.getPositionRaw();
+}
+
+/**
+* Steps a filter from one value to another, returning the number of
+* readings until it settled exactly on the new value. Checks that the
+* response moves monotonically towards the target without overshooting.
+*/
+static int stepResponse(AnalogInput& input, AnalogValue from, AnalogValue to, int limit = 2000) {
+	input.setPosition(from);
+	const bool rising = (to > from);
+	AnalogValue last = from;
+
+	for (int n = 1; n <= limit; ++n) {
+		const AnalogValue out = filterStep(input, to);
+		CHECK(rising ? (out >= last && out <= to) : (out <= last && out >= to));
+		if (out == to) return n;
+		last = out;
+	}
+	return -1;  // never settled
+}
+
+TEST_CASE(ema_step_response) {
+	const AnalogValue steps[][2] = {
+		{ 0, 1023 }, { 1023, 0 }, { 500, 501 }, { 501, 500 }, { 300, 310 }, { 310, 300 },
+	};
+
+	for (uint8_t strength = 1; strength <= 7; ++strength) {
+		AnalogInput input(PinAxis);
+		input.setFilter(AnalogInput::FilterEMA, strength);
+		filterStep(input, 0);  // prime
+
+		for (const auto& step : steps) {
+			// follows a floating point EMA to within rounding
+			input.setPosition(step[0]);
+			double ideal = step[0];
+			const double alpha = 1.0 / (1 << strength);
+			for (int n = 0; n < 20; ++n) {
+				ideal += (step[1] - ideal) * alpha;
+				const AnalogValue out = filterStep(input, step[1]);
+				CHECK(fabs(out - ideal) <= 1.0);
+			}
+
+			// and settles exactly, in both directions
+			const int readings = stepResponse(input, step[0], step[1]);
+			CHECK(readings > 0);
+
+			// within about the time for the error to fall below half a count
+			const double bound = log(2.0 * abs(step[1] - step[0])) / -log(1.0 - alpha) + 2;
+			CHECK(readings <= (int) bound);
+		}
+	}
+}
+
+TEST_CASE(median_rejects_spikes) {
+	for (uint8_t window = 3; window <= 5; window += 2) {
+		AnalogInput input(PinAxis);
+		input.setFilter(AnalogInput::FilterMedian, window);
+		filterStep(input, 0);
+
+		// spikes shorter than half the window never reach the output
+		for (int width = 1; width <= window / 2; ++width) {
+			input.setPosition(400);
+			for (int i = 0; i < width; ++i) CHECK_EQUAL(400, filterStep(input, 1000));
+			for (int i = 0; i < window; ++i) CHECK_EQUAL(400, filterStep(input, 400));
+		}
+
+		// a step passes through once it fills over half of the window
+		CHECK_EQUAL(window / 2 + 1, stepResponse(input, 400, 800));
+		CHECK_EQUAL(window / 2 + 1, stepResponse(input, 800, 400));
+	}
+}
+
+TEST_CASE(one_euro_step_response) {
+	const AnalogValue steps[][2] = {
+		{ 0, 1023 }, { 1023, 0 }, { 500, 501 }, { 501, 500 }, { 300, 310 }, { 310, 300 },
+	};
+
+	AnalogInput euro(PinAxis);
+	euro.setFilter(AnalogInput::FilterOneEuro);  // 1/16 at rest
+	filterStep(euro, 0);
+
+	AnalogInput ema(PinAxis);
+	ema.setFilter(AnalogInput::FilterEMA, 4);  // also 1/16
+	filterStep(ema, 0);
+
+	for (const auto& step : steps) {
+		const int readings = stepResponse(euro, step[0], step[1]);
+		CHECK(readings > 0);
+
+		// opens up to follow large moves faster than a plain EMA with
+		// the same smoothing at rest
+		if (abs(step[1] - step[0]) > 100) {
+			CHECK(readings < stepResponse(ema, step[0], step[1]) / 4);
+		}
+	}
+
+	// while at rest, noise is smoothed as heavily as the EMA
+	euro.setPosition(500);
+	ema.setPosition(500);
+	int euroSpread = 0, emaSpread = 0;
+	srand(7);
+	for (int i = 0; i < 1000; ++i) {
+		const AnalogValue noisy = 500 + (rand() % 5) - 2;
+		euroSpread = std::max(euroSpread, abs(filterStep(euro, noisy) - 500));
+		emaSpread = std::max(emaSpread, abs(filterStep(ema, noisy) - 500));
+	}
+	CHECK(euroSpread <= emaSpread + 1);
+	CHECK(euroSpread <= 1);
+}
+
+TEST_CASE(adaptive_deadband_follows_noise) {
+	AnalogInput input(PinAxis);
+	input.setDeadband(2, true);
+	CHECK_EQUAL(2, input.getDeadband());
+
+	// noise of 6 counts between readings, within the gate
+	for (int i = 0; i < 500; ++i) {
+		HostHAL::setAnalog(PinAxis, 500 + ((i & 1) ? 6 : 0));
+		input.read();
+	}
+	const int widened = input.getDeadband();
+	CHECK_EQUAL(2 + 2 * 6, widened);
+
+	// moving steadily, 30 counts per reading. This is movement, and
+	// shouldn't be counted as noise even though the deadband is wider.
+	AnalogValue position = 0;
+	for (int i = 0; i < 500; ++i) {
+		position = (position + 30) % 1000;
+		HostHAL::setAnalog(PinAxis, position);
+		input.read();
+	}
+	CHECK_EQUAL(widened, input.getDeadband());
+
+	// and back at rest, the estimate decays all the way down
+	for (int i = 0; i < 2000; ++i) input.read();
+	CHECK_EQUAL(2, input.getDeadband());
+}
@@ -0,0 +1,106 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+* Checks the fixed point calibration math (SIM_RACING_FIXED_POINT) against
+* the floating point math it replaces.
+*
+* The thresholds are private, so this test opens up the class rather than
+* adding accessors to the library for it.
+*/
+
+#include "HostTest.h"
+
+#define private public
+#define protected public
+#include <SimRacing.h>
+#undef private
+#undef protected
+
+#include <stdlib.h>
+
+#include <random>
+
+#if !SIM_RACING_FIXED_POINT
+#error "This test needs the library built with SIM_RACING_FIXED_POINT"
+#endif
+
+using namespace SimRacing;
+
+/** Thresholds as the floating point build computes them, truncated */
+static AnalogValue floatAbove(AnalogValue neutral, AnalogValue diff, float pct) {
+	return (AnalogValue) (neutral + (float) diff * pct);
+}
+
+static AnalogValue floatBelow(AnalogValue neutral, AnalogValue diff, float pct) {
+	return (AnalogValue) (neutral - (float) diff * pct);
+}
+
+
+TEST_CASE(fraction_from_constants) {
+	CHECK_EQUAL(0, Fraction(0.0).value);
+	CHECK_EQUAL(0, Fraction(-1.0).value);
+	CHECK_EQUAL(0x8000, Fraction(0.5).value);
+	CHECK_EQUAL(0xFFFF, Fraction(1.0).value);
+	CHECK_EQUAL(0xFFFF, Fraction(2.0).value);
+
+	for (int i = 0; i <= 100; ++i) {
+		CHECK_EQUAL((long) lround(i / 100.0 * 65536.0) - (i == 100), (long) Fraction(i / 100.0).value);
+	}
+}
+
+TEST_CASE(thresholds_match_float) {
+	std::mt19937 rng(20);
+	auto random = [&](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+	auto position = [&]() {
+		return AnalogShifter::GearPosition{ (AnalogValue) random(0, AnalogInput::Max), (AnalogValue) random(0, AnalogInput::Max) };
+	};
+
+	int worst = 0;
+	for (int trial = 0; trial < 20000; ++trial) {
+		AnalogShifter shifter(-1, 6, A0, A1);
+
+		const int engage = random(0, 100), release = random(0, 100), edge = random(0, 100);
+		const AnalogShifter::GearPosition neutral = { (AnalogValue) random(300, 700), (AnalogValue) random(300, 700) };
+		shifter.setCalibration(neutral, position(), position(), position(), position(), position(), position(),
+			engage / 100.0, release / 100.0, edge / 100.0);
+
+		const AnalogShifter::Calibration& c = shifter.calibration;
+		const AnalogValue nx = shifter.normalizePosition(Axis::X, neutral.x);
+		const AnalogValue ny = shifter.normalizePosition(Axis::Y, neutral.y);
+		const AnalogValue maxDiffY = AnalogInput::Max - ny, minDiffY = ny - AnalogInput::Min;
+		const AnalogValue maxDiffX = AnalogInput::Max - nx, minDiffX = nx - AnalogInput::Min;
+
+		const int errors[] = {
+			c.oddTrigger - floatAbove(ny, maxDiffY, engage / 100.0f),
+			c.oddRelease - floatAbove(ny, maxDiffY, release / 100.0f),
+			c.evenTrigger - floatBelow(ny, minDiffY, engage / 100.0f),
+			c.evenRelease - floatBelow(ny, minDiffY, release / 100.0f),
+			c.edges[0] - floatBelow(nx, minDiffX, edge / 100.0f),
+			c.edges[1] - (floatAbove(nx, maxDiffX, edge / 100.0f) + 1),
+		};
+		for (int e : errors) {
+			if (abs(e) > worst) worst = abs(e);
+		}
+	}
+	CHECK(worst <= 1);
+}
@@ -0,0 +1,71 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "HostTest.h"
+#include "HostHAL.h"
+
+#include <SimRacing.h>
+
+#include <limits.h>
+
+#include <random>
+
+using namespace SimRacing;
+
+
+TEST_CASE(frame_millis_follow_micros) {
+	std::mt19937 rng(13);
+
+	// not starting on a whole millisecond
+	HostHAL::setMicros(123456);
+	Frame frame;
+	CHECK_EQUAL(millis(), frame.getMillis());
+
+	for (unsigned long i = 1; i <= 100000; ++i) {
+		// mostly short frames, with the occasional long gap
+		unsigned long step = rng() % 3000;
+		if (i % 1000 == 0) step = 8000 + rng() % 100000;
+		if (i % 25000 == 0) step = 10000000;
+		HostHAL::advanceMicros(step);
+
+		frame.tick();
+		CHECK_EQUAL(micros(), frame.getMicros());
+		CHECK_EQUAL(millis(), frame.getMillis());
+		CHECK_EQUAL(i, frame.getCount());
+		if (frame.getMillis() != millis()) break;  // one failure is enough
+	}
+}
+
+TEST_CASE(frame_millis_across_wrap) {
+	const unsigned long start = ULONG_MAX - 2500;
+	HostHAL::setMicros(start);
+	Frame frame;
+	const unsigned long startMillis = frame.getMillis();
+
+	unsigned long elapsed = 0;
+	for (int i = 0; i < 100; ++i) {
+		HostHAL::advanceMicros(700);
+		elapsed += 700;
+		frame.tick();
+		CHECK_EQUAL(((start % 1000) + elapsed) / 1000, frame.getMillis() - startMillis);
+	}
+}
@@ -0,0 +1,128 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "HostTest.h"
+#include "HostHAL.h"
+
+#include <SimRacing.h>
+
+using namespace SimRacing;
+
+/**
+* @brief Peripheral that counts its updates, and optionally takes some
+*        time to run
+*/
+class Counter : public Peripheral {
+public:
+	Counter(unsigned long cost = 0) : cost(cost) {}
+
+	unsigned long updates = 0;
+	unsigned long cost;  ///< time each update takes, in us
+
+protected:
+	bool updateState(bool) override {
+		updates++;
+		HostHAL::advanceMicros(cost);
+		return false;
+	}
+};
+
+
+TEST_CASE(runs_at_rate) {
+	Scheduler scheduler;
+	Counter task;
+	CHECK(scheduler.add(task, 1000));  // 1 ms
+
+	for (int i = 0; i < 10000; ++i) {
+		scheduler.update();
+		HostHAL::advanceMicros(100);
+	}
+	CHECK_EQUAL(1000UL, task.updates);
+	CHECK_EQUAL(0UL, scheduler.getStats(task).missed);
+}
+
+TEST_CASE(reset_stats_keeps_schedule) {
+	Scheduler scheduler;
+	Counter task;
+	scheduler.add(task, 100);  // 10 ms
+
+	scheduler.update();
+	CHECK_EQUAL(1UL, task.updates);
+
+	// resetting the stats shouldn't make the task due again
+	scheduler.resetStats();
+	HostHAL::advanceMicros(1000);
+	scheduler.update();
+	CHECK_EQUAL(1UL, task.updates);
+	CHECK_EQUAL(0UL, scheduler.getStats(task).runs);
+
+	HostHAL::advanceMicros(9000);
+	scheduler.update();
+	CHECK_EQUAL(2UL, task.updates);
+	CHECK_EQUAL(1UL, scheduler.getStats(task).runs);
+	CHECK_EQUAL(0UL, scheduler.getStats(task).lastJitter);
+}
+
+TEST_CASE(jitter_includes_earlier_tasks) {
+	Scheduler scheduler;
+	Counter slow, fast;
+	scheduler.add(slow, 100);
+	scheduler.add(fast, 1000);
+
+	// both start on the first update, with the slow task run first
+	scheduler.update();
+	CHECK_EQUAL(0UL, scheduler.getStats(slow).lastJitter);
+	CHECK_EQUAL(0UL, scheduler.getStats(fast).lastJitter);
+	slow.cost = 300;
+
+	// both due together again at 10 ms. The fast task waits for the
+	// slow one, and is 300 us late.
+	while (slow.updates < 2) {
+		HostHAL::advanceMicros(10);
+		scheduler.update();
+	}
+	CHECK_EQUAL(0UL, scheduler.getStats(slow).lastJitter);
+	CHECK_EQUAL(300UL, scheduler.getStats(fast).lastJitter);
+	CHECK_EQUAL(300UL, scheduler.getStats(fast).maxJitter);
+}
+
+TEST_CASE(missed_deadlines_restart) {
+	Scheduler scheduler;
+	Counter task;
+	scheduler.add(task, 1000);
+
+	scheduler.update();
+	HostHAL::advanceMicros(3500);
+	scheduler.update();
+	CHECK_EQUAL(2UL, task.updates);
+	CHECK_EQUAL(2500UL, scheduler.getStats(task).lastJitter);
+	CHECK_EQUAL(2UL, scheduler.getStats(task).missed);
+
+	// the schedule restarts from the late update
+	HostHAL::advanceMicros(999);
+	scheduler.update();
+	CHECK_EQUAL(2UL, task.updates);
+	HostHAL::advanceMicros(1);
+	scheduler.update();
+	CHECK_EQUAL(3UL, task.updates);
+}
@@ -0,0 +1,214 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "HostTest.h"
+
+#include <SimRacing.h>
+
+using namespace SimRacing;
+
+static const PinNum PinX = A0;
+static const PinNum PinY = A1;
+static const PinNum PinReverse = 5;
+
+static const AnalogShifter::GearPosition Neutral = { 512, 512 };
+static const AnalogShifter::GearPosition Gears[] = {
+	{ 200, 900 }, { 200, 100 },  // 1, 2
+	{ 512, 900 }, { 512, 100 },  // 3, 4
+	{ 800, 900 }, { 800, 100 },  // 5, 6
+};
+
+/** Moves the stick, and updates the shifter until it settles */
+static Shifter::Gear shiftTo(AnalogShifter& shifter, AnalogValue x, AnalogValue y, bool reverse = false) {
+	HostHAL::setAnalog(PinX, x);
+	HostHAL::setAnalog(PinY, y);
+	HostHAL::setDigital(PinReverse, reverse);
+	shifter.update();
+	shifter.update();
+	return shifter.getGear();
+}
+
+
+TEST_CASE(default_gate_selects_every_gear) {
+	AnalogShifter shifter(-1, 6, PinX, PinY, PinReverse);
+	shifter.begin();
+	shifter.setCalibration(Neutral, Gears[0], Gears[1], Gears[2], Gears[3], Gears[4], Gears[5]);
+
+	CHECK_EQUAL(0, shiftTo(shifter, Neutral.x, Neutral.y));
+
+	for (int i = 0; i < 6; ++i) {
+		CHECK_EQUAL(i + 1, shiftTo(shifter, Gears[i].x, Gears[i].y));
+		CHECK_EQUAL(0, shiftTo(shifter, Neutral.x, Neutral.y));
+	}
+
+	// reverse shares the slot with 6th
+	CHECK_EQUAL(-1, shiftTo(shifter, Gears[5].x, Gears[5].y, true));
+	CHECK(shifter.getReverseButton());
+}
+
+TEST_CASE(engaged_gear_holds_until_release) {
+	AnalogShifter shifter(-1, 6, PinX, PinY, PinReverse);
+	shifter.begin();
+	shifter.setCalibration(Neutral, Gears[0], Gears[1], Gears[2], Gears[3], Gears[4], Gears[5], 0.70, 0.50);
+
+	// 1st engages at 70% of the way to the top, and
+	// releases at 50% of the way
+	CHECK_EQUAL(0, shiftTo(shifter, 200, 512 + 388 * 65 / 100));
+	CHECK_EQUAL(1, shiftTo(shifter, 200, 512 + 388 * 75 / 100));
+	CHECK_EQUAL(1, shiftTo(shifter, 200, 512 + 388 * 55 / 100));
+	CHECK_EQUAL(0, shiftTo(shifter, 200, 512 + 388 * 45 / 100));
+}
+
+TEST_CASE(gears_limited_to_range) {
+	AnalogShifter shifter(1, 4, PinX, PinY, PinReverse);
+	shifter.begin();
+	shifter.setCalibration(Neutral, Gears[0], Gears[1], Gears[2], Gears[3], Gears[4], Gears[5]);
+
+	CHECK_EQUAL(0, shiftTo(shifter, Neutral.x, Neutral.y));
+	CHECK_EQUAL(4, shiftTo(shifter, Gears[3].x, Gears[3].y));
+	CHECK_EQUAL(0, shiftTo(shifter, Neutral.x, Neutral.y));
+	CHECK_EQUAL(0, shiftTo(shifter, Gears[4].x, Gears[4].y));
+	CHECK_EQUAL(0, shiftTo(shifter, Neutral.x, Neutral.y));
+	CHECK_EQUAL(0, shiftTo(shifter, Gears[5].x, Gears[5].y, true));
+}
+
+TEST_CASE(custom_gate_map) {
+	AnalogShifter shifter(-1, 8, PinX, PinY, PinReverse);
+	shifter.begin();
+
+	const AnalogShifter::GateMap map = { 4, { 1, 3, 5, 7 }, { 2, 4, 6, -1 }, AnalogShifter::ReverseLockout, 0 };
+	CHECK(shifter.setGateMap(map));
+
+	const AnalogShifter::GearPosition gears[] = {
+		{ 100, 900 }, { 100, 100 }, { 400, 900 }, { 400, 100 }, { 700, 900 }, { 700, 100 }, { 1000, 900 },
+	};
+	shifter.setCalibration({ 550, 500 }, gears, { 1000, 100 });
+
+	const struct {
+		AnalogValue x, y;
+		bool reverse;
+		Shifter::Gear gear;
+	} cases[] = {
+		{ 100, 900, false, 1 }, { 100, 100, false, 2 }, { 400, 900, false, 3 }, { 700, 100, false, 6 },
+		{ 1000, 900, false, 7 },
+		{ 1000, 100, false, 0 },  // locked out
+		{ 1000, 100, true, -1 },
+	};
+
+	for (const auto& c : cases) {
+		CHECK_EQUAL(0, shiftTo(shifter, 550, 500));
+		CHECK_EQUAL(c.gear, shiftTo(shifter, c.x, c.y, c.reverse));
+	}
+
+	// 4th gear twice
+	const AnalogShifter::GateMap bad = { 3, { 1, 3, 5 }, { 2, 4, 4 }, AnalogShifter::ReverseSlot, 0 };
+	CHECK(!shifter.setGateMap(bad));
+}
+
+TEST_CASE(shift_stats_time_neutral) {
+	AnalogShifter shifter(-1, 6, PinX, PinY, PinReverse);
+	shifter.setCalibration(Neutral, Gears[0], Gears[1], Gears[2], Gears[3], Gears[4], Gears[5]);
+	HostHAL::setAnalog(PinX, Neutral.x);
+	HostHAL::setAnalog(PinY, Neutral.y);
+	shifter.begin();
+
+	shiftTo(shifter, Gears[0].x, Gears[0].y);  // from a start in neutral, not a shift
+	CHECK_EQUAL(0, shifter.getShiftStats().shifts);
+
+	shiftTo(shifter, Neutral.x, Neutral.y);
+	HostHAL::advanceMillis(120);
+	shiftTo(shifter, Gears[1].x, Gears[1].y);
+
+	const Shifter::ShiftStats& stats = shifter.getShiftStats();
+	CHECK_EQUAL(1, stats.shifts);
+	CHECK_EQUAL(120, stats.last);
+	CHECK_EQUAL(120, stats.fastest);
+	CHECK_EQUAL(120, stats.slowest);
+}
+
+TEST_CASE(shift_stats_skip_disconnects) {
+	const PinNum pinDetect = 7;
+	LogitechShifter shifter(PinX, PinY, PinReverse, pinDetect);
+	shifter.setCalibration(Neutral, Gears[0], Gears[1], Gears[2], Gears[3], Gears[4], Gears[5]);
+
+	// connect, and wait for the connection to settle
+	HostHAL::setDigital(pinDetect, HIGH);
+	shifter.begin();
+	for (int i = 0; i < 30; ++i) {
+		HostHAL::advanceMillis(10);
+		shiftTo(shifter, Neutral.x, Neutral.y);
+	}
+	CHECK(shifter.isConnected());
+
+	CHECK_EQUAL(3, shiftTo(shifter, Gears[2].x, Gears[2].y));
+	shifter.resetShiftStats();
+
+	// unplugged in gear, which drops to neutral
+	HostHAL::setDigital(pinDetect, LOW);
+	CHECK_EQUAL(0, shiftTo(shifter, Gears[2].x, Gears[2].y));
+	CHECK(!shifter.isConnected());
+
+	// plugged back in a long time later, and put in gear
+	HostHAL::advanceMillis(5000);
+	HostHAL::setDigital(pinDetect, HIGH);
+	for (int i = 0; i < 30; ++i) {
+		HostHAL::advanceMillis(10);
+		shiftTo(shifter, Neutral.x, Neutral.y);
+	}
+	CHECK_EQUAL(4, shiftTo(shifter, Gears[3].x, Gears[3].y));
+
+	// neither of those were shifts
+	CHECK_EQUAL(0, shifter.getShiftStats().shifts);
+}
+
+TEST_CASE(unused_buttons_release) {
+	const PinNum pinLatch = 10, pinClock = 15, pinData = 14;
+	LogitechShifterG27 shifter(PinX, PinY, pinLatch, pinClock, pinData);
+	HostHAL::attachShiftRegisters(pinLatch, pinClock, pinData);
+
+	LogitechShifterG27::ButtonEvent buffer[8];
+	shifter.setButtonEventBuffer(buffer, 8);
+
+	using Button = LogitechShifterG27::Button;
+	const uint16_t held = (1 << Button::BUTTON_1) | (1 << Button::BUTTON_SOUTH);
+	HostHAL::setShiftRegisters({ (uint8_t) (held >> 8), (uint8_t) held });
+
+	shifter.begin();
+	shifter.update();
+	CHECK(shifter.getButton(Button::BUTTON_1));
+	CHECK(shifter.getButton(Button::BUTTON_SOUTH));
+
+	LogitechShifterG27::ButtonEvent event;
+	while (shifter.getButtonEvent(event)) {}  // clear the presses
+
+	// stop reading the bottom byte, while SOUTH is still held
+	shifter.setUsedButtons(0xFF00);
+	CHECK(shifter.update());
+	CHECK(shifter.getButton(Button::BUTTON_1));
+	CHECK(!shifter.getButton(Button::BUTTON_SOUTH));
+
+	CHECK(shifter.getButtonEvent(event));
+	CHECK_EQUAL((int) Button::BUTTON_SOUTH, (int) event.button);
+	CHECK(!event.pressed);
+	CHECK(!shifter.getButtonEvent(event));
+}
@@ -0,0 +1,166 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+* Checks the shifter's lookup grid against direct comparisons with the
+* calibrated thresholds, for every input.
+*
+* The grid and the thresholds are private, so this test opens up the
+* class rather than adding accessors to the library for it.
+*/
+
+#include "HostTest.h"
+
+#define private public
+#define protected public
+#include <SimRacing.h>
+#undef private
+#undef protected
+
+#include <random>
+
+using namespace SimRacing;
+
+static const PinNum PinX = A0;
+static const PinNum PinY = A1;
+static const PinNum PinReverse = 5;
+
+/** Shifter that can be forced into a gear, and updated without the connection check */
+class TestShifter : public AnalogShifter {
+public:
+	TestShifter(Gear gearMin = -1, Gear gearMax = 6) : AnalogShifter(gearMin, gearMax, PinX, PinY, PinReverse) {}
+
+	void forceGear(Gear gear) {
+		this->setGear(gear);
+		this->setGear(gear);  // clear the 'changed' flag
+	}
+	void step() { this->updateState(true); }
+};
+
+/**
+* The gear for a position in the default gate, as computed before the grid
+* was added: each threshold compared directly, with the Logitech layout
+* written out by hand.
+*/
+static Shifter::Gear directGear(const AnalogShifter& s, AnalogValue x, AnalogValue y, Shifter::Gear previous, bool reverse) {
+	const AnalogShifter::Calibration& c = s.calibration;
+	const bool prevOdd = (previous != -1) && (previous & 1);
+	const bool prevEven = !prevOdd && previous != 0;
+
+	if ((prevOdd && y > c.oddRelease) || (prevEven && y < c.evenRelease)) return previous;
+
+	Shifter::Gear gear = 0;
+	if (y > c.oddTrigger) gear = 1;
+	else if (y < c.evenTrigger) gear = 2;
+	else return 0;
+
+	if (x >= c.edges[1]) gear += 4;       // right column
+	else if (x >= c.edges[0]) gear += 2;  // middle column
+
+	if (reverse && gear == 5) gear = 0;
+	else if ((reverse || previous == -1) && gear == 6) gear = -1;
+	return gear;
+}
+
+
+TEST_CASE(grid_cells_match_thresholds) {
+	std::mt19937 rng(1);
+	auto random = [&](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+
+	const AnalogShifter::GateMap maps[] = {
+		AnalogShifter::DefaultGateMap,
+		{ 2, { 1, 3 }, { 2, 4 }, AnalogShifter::ReverseSlot, 0 },
+		{ 4, { 1, 3, 5, 7 }, { 2, 4, 6, -1 }, AnalogShifter::ReverseLockout, 0 },
+		{ 5, { -1, 1, 3, 5, 7 }, { 0, 2, 4, 6, 8 }, AnalogShifter::ReverseSlot, 0 },
+	};
+
+	for (int trial = 0; trial < 200; ++trial) {
+		TestShifter shifter(-1, 8);
+		const AnalogShifter::GateMap& map = maps[trial % 4];
+		CHECK(shifter.setGateMap(map));
+
+		AnalogShifter::GearPosition gears[8];
+		for (AnalogShifter::GearPosition& g : gears) {
+			g = { (AnalogValue) random(0, AnalogInput::Max), (AnalogValue) random(0, AnalogInput::Max) };
+		}
+		const AnalogShifter::GearPosition neutral = { (AnalogValue) random(300, 700), (AnalogValue) random(300, 700) };
+		const AnalogShifter::GearPosition reverse = { (AnalogValue) random(0, AnalogInput::Max), (AnalogValue) random(0, AnalogInput::Max) };
+		shifter.setCalibration(neutral, gears, reverse, random(0, 100) / 100.0, random(0, 100) / 100.0);
+
+		// every input position, on both axes
+		const uint8_t shift = AnalogInput::Resolution - AnalogShifter::GridBits;
+		int mismatches = 0;
+		for (AnalogValue v = 0; v <= AnalogInput::Max; ++v) {
+			const uint8_t cell = shifter.grid[v >> shift];
+
+			const uint8_t cellX = cell >> AnalogShifter::GridColumnShift;
+			const uint8_t column = (cellX == AnalogShifter::GridColumnSplit) ? shifter.classifyColumn(v) : cellX;
+			if (column != shifter.classifyColumn(v)) mismatches++;
+
+			const uint8_t cellY = cell & AnalogShifter::GridZoneMask;
+			const uint8_t zone = (cellY & AnalogShifter::GridZoneSplit) ? shifter.classifyZone(v) : cellY;
+			if (zone != shifter.classifyZone(v)) mismatches++;
+		}
+		CHECK_EQUAL(0, mismatches);
+	}
+}
+
+TEST_CASE(same_gear_for_every_input) {
+	std::mt19937 rng(2);
+	auto random = [&](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+	auto position = [&]() {
+		return AnalogShifter::GearPosition{ (AnalogValue) random(0, AnalogInput::Max), (AnalogValue) random(0, AnalogInput::Max) };
+	};
+
+	long checked = 0;
+	long mismatches = 0;
+
+	for (int trial = 0; trial < 300; ++trial) {
+		TestShifter shifter;
+		shifter.begin();
+
+		const AnalogShifter::GearPosition neutral = { (AnalogValue) random(300, 700), (AnalogValue) random(300, 700) };
+		shifter.setCalibration(neutral, position(), position(), position(), position(), position(), position(),
+			random(0, 100) / 100.0, random(0, 100) / 100.0, random(0, 100) / 100.0);
+
+		for (int i = 0; i < 4000; ++i) {
+			const bool reverse = random(0, 1);
+			const Shifter::Gear previous = random(-1, 6);
+
+			HostHAL::setAnalog(PinX, random(0, AnalogInput::Max));
+			HostHAL::setAnalog(PinY, random(0, AnalogInput::Max));
+			HostHAL::setDigital(PinReverse, reverse);
+
+			shifter.forceGear(previous);
+			shifter.step();
+
+			const AnalogValue x = shifter.getPosition(Axis::X);
+			const AnalogValue y = shifter.getPosition(Axis::Y);
+			if (shifter.getGear() != directGear(shifter, x, y, previous, reverse)) mismatches++;
+			checked++;
+		}
+	}
+
+	CHECK_EQUAL(0, mismatches);
+	CHECK_EQUAL(300 * 4000, checked);
+}
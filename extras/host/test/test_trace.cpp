@@ -0,0 +1,278 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "HostTest.h"
+
+#include <SimRacing.h>
+#include <TraceReplayer.h>
+
+#include <random>
+
+using namespace SimRacing;
+
+/** Writes a set of records, and checks they read back the same */
+static void checkRoundTrip(const std::vector<TraceReader::Record>& records) {
+	MemoryStream stream;
+	TraceRecorder recorder(stream);
+	recorder.begin();
+
+	for (const TraceReader::Record& r : records) {
+		CHECK(recorder.record(r.source, r.pin, r.value, r.time));
+	}
+	CHECK_EQUAL(records.size(), recorder.getCount());
+	CHECK_EQUAL(stream.getData().size(), recorder.getSize());
+
+	TraceReader reader(stream);
+	CHECK(reader.begin());
+
+	TraceReader::Record out;
+	for (const TraceReader::Record& r : records) {
+		if (!reader.read(out)) {
+			CHECK(false);
+			return;
+		}
+		CHECK_EQUAL((int) r.source, (int) out.source);
+		CHECK_EQUAL(r.pin, out.pin);
+		CHECK_EQUAL(r.value, out.value);
+		CHECK_EQUAL(r.time, out.time);
+	}
+	CHECK(!reader.read(out));
+	CHECK(reader.isValid());
+}
+
+
+TEST_CASE(codec_round_trip) {
+	std::mt19937 rng(1);
+	std::vector<TraceReader::Record> records;
+
+	const TraceSource sources[] = { TraceSource::Analog, TraceSource::Pin, TraceSource::ShiftRegisters };
+	uint32_t time = 0xFFFF0000;  // wraps around partway through
+
+	for (int i = 0; i < 20000; ++i) {
+		const uint8_t channel = rng() % TraceFormat::MaxChannels;
+		time += rng() % 3000;
+		records.push_back({ sources[channel % 3], (PinNum) (channel + 14), (uint16_t) rng(), time });
+	}
+	checkRoundTrip(records);
+
+	// the extremes of each field
+	checkRoundTrip({
+		{ TraceSource::Analog, 0, 0xFFFF, 0xFFFFFFFF },
+		{ TraceSource::Analog, 0, 0x0000, 0x00000000 },
+		{ TraceSource::Analog, 0, 0xFFFF, 0x7FFFFFFF },
+		{ TraceSource::Pin, 254, 1, 0x80000000 },
+	});
+}
+
+TEST_CASE(codec_steady_reads_take_one_byte) {
+	MemoryStream stream;
+	TraceRecorder recorder(stream);
+	recorder.begin();
+
+	// three channels read every millisecond, drifting by one count
+	for (uint32_t i = 0; i < 1000; ++i) {
+		recorder.record(TraceSource::Analog, A0, 500 + (i % 2), i * 1000);
+		recorder.record(TraceSource::Analog, A1, 200, i * 1000 + 120);
+		recorder.record(TraceSource::Pin, 7, 1, i * 1000 + 240);
+	}
+
+	// the first two reads of each channel set the value and the
+	// interval, and everything after is one byte
+	const size_t setup = TraceFormat::HeaderSize + 3 * (3 + 4 + 3);
+	CHECK(recorder.getSize() <= setup + 3 * 998);
+}
+
+TEST_CASE(codec_rejects_bad_traces) {
+	MemoryStream stream;
+	TraceRecorder recorder(stream);
+	recorder.begin();
+	recorder.record(TraceSource::Analog, A0, 1000, 5000);
+
+	// bad header
+	{
+		std::vector<uint8_t> data = stream.getData();
+		data[0] = 'X';
+		MemoryStream bad(data);
+		TraceReader reader(bad);
+		CHECK(!reader.begin());
+	}
+
+	// truncated in the middle of a varint
+	{
+		std::vector<uint8_t> data = stream.getData();
+		data.pop_back();
+		MemoryStream bad(data);
+		TraceReader reader(bad);
+		CHECK(reader.begin());
+
+		TraceReader::Record rec;
+		CHECK(!reader.read(rec));
+		CHECK(!reader.isValid());
+	}
+
+	// too many channels
+	for (uint8_t i = 0; i <= TraceFormat::MaxChannels; ++i) {
+		CHECK(recorder.record(TraceSource::Pin, i, 0, 0) == (i + 1 < TraceFormat::MaxChannels));
+	}
+}
+
+
+/**
+* Runs a device through a scripted session, recording its raw inputs, and
+* then replays the trace with the hardware inputs held at zero. Checks that
+* the device produces the same output on every update.
+*
+* @param device  the device to test
+* @param script  sets the hardware inputs for each update
+* @param output  captures the device state after each update
+* @param updates the number of updates to run
+*/
+template<class Device, class Script, class Output>
+static void checkReplay(Device& device, Script script, Output output, int updates) {
+	typedef decltype(output(device)) State;
+
+	MemoryStream trace;
+	TraceRecorder recorder(trace);
+	std::vector<State> recorded;
+
+	recorder.begin();
+	setTraceHook(&recorder);
+	device.begin();
+	for (int i = 0; i < updates; ++i) {
+		script(i);
+		device.update();
+		recorded.push_back(output(device));
+		HostHAL::advanceMicros(1000);
+	}
+	setTraceHook(nullptr);
+
+	printf("  %lu reads in %lu bytes (%.2f bytes/read)\n",
+		recorder.getCount(), recorder.getSize(), (double) recorder.getSize() / recorder.getCount());
+
+	// replay from the same starting point, with nothing on the inputs
+	HostHAL::reset();
+	for (PinNum pin = 0; pin < NUM_DIGITAL_PINS; ++pin) HostHAL::setAnalog(pin, 0);
+
+	TraceReplayer replayer(trace);
+	CHECK(replayer.begin());
+	setTraceHook(&replayer);
+	device.begin();
+
+	int matching = 0;
+	for (int i = 0; i < updates; ++i) {
+		device.update();
+		if (output(device) == recorded[i]) matching++;
+		HostHAL::advanceMicros(1000);
+	}
+	setTraceHook(nullptr);
+
+	CHECK_EQUAL(updates, matching);
+	CHECK_EQUAL(0, replayer.getMismatches());
+	CHECK_EQUAL(recorder.getCount(), replayer.getCount());
+	CHECK(replayer.done());
+}
+
+/** Smooth random movement, with a bit of noise */
+class Wander {
+public:
+	Wander(uint32_t seed, int min = 0, int max = 1023) : rng(seed), min(min), max(max), value((min + max) / 2) {}
+
+	int operator()() {
+		if (this->steps == 0) {
+			this->target = this->min + (int) (this->rng() % (this->max - this->min + 1));
+			this->steps = 50 + this->rng() % 200;
+		}
+		this->steps--;
+		this->value += (this->target - this->value) / 8;
+		return constrain(this->value + (int) (this->rng() % 5) - 2, 0, 1023);
+	}
+
+private:
+	std::mt19937 rng;
+	int min, max;
+	int value;
+	int target = 0;
+	unsigned int steps = 0;
+};
+
+
+TEST_CASE(replay_logitech_pedals) {
+	const PinNum pinDetect = 7;
+	LogitechPedals pedals(A0, A1, A2, pinDetect);
+	pedals.setCalibration({ 100, 900 }, { 50, 950 }, { 200, 800 });
+
+	Wander gas(1), brake(2), clutch(3);
+
+	auto script = [&](int i) {
+		HostHAL::setAnalog(A0, gas());
+		HostHAL::setAnalog(A1, brake());
+		HostHAL::setAnalog(A2, clutch());
+		HostHAL::setDigital(pinDetect, (i % 3000) > 200);  // unplugged now and then
+	};
+	auto output = [](LogitechPedals& p) {
+		return std::vector<long>{
+			p.isConnected(),
+			p.getPosition(Gas), p.getPosition(Brake), p.getPosition(Clutch),
+		};
+	};
+	checkReplay(pedals, script, output, 10000);
+}
+
+TEST_CASE(replay_logitech_shifter_g25) {
+	const PinNum pinLatch = 10, pinClock = 15, pinData = 14, pinLed = 16, pinDetect = 7;
+	LogitechShifterG25 shifter(A1, A0, pinLatch, pinClock, pinData, pinLed, pinDetect);
+	HostHAL::attachShiftRegisters(pinLatch, pinClock, pinData);
+
+	Wander x(4), y(5);
+	std::mt19937 rng(6);
+	uint16_t buttons = 0;
+
+	auto script = [&](int i) {
+		HostHAL::setAnalog(A1, x());
+		HostHAL::setAnalog(A0, y());
+		if (i % 97 == 0) buttons = rng() & 0x5FFF;  // the pull-down bits stay low
+		HostHAL::setShiftRegisters({ (uint8_t) (buttons >> 8), (uint8_t) buttons });
+		HostHAL::setDigital(pinDetect, (i % 4000) > 300);
+	};
+	auto output = [](LogitechShifterG25& s) {
+		std::vector<long> state = { s.isConnected(), s.getGear(), s.getPosition(Axis::X), s.getPosition(Axis::Y) };
+		for (uint8_t b = 0; b < 16; ++b) state.push_back(s.getButton((LogitechShifterG25::Button) b));
+		return state;
+	};
+	checkReplay(shifter, script, output, 10000);
+}
+
+TEST_CASE(replay_handbrake) {
+	Handbrake handbrake(A3);
+	handbrake.setCalibration({ 300, 700 });
+
+	Wander lever(7, 250, 750);
+
+	auto script = [&](int) {
+		HostHAL::setAnalog(A3, lever());
+	};
+	auto output = [](Handbrake& h) {
+		return h.getPosition(0, 1000);
+	};
+	checkReplay(handbrake, script, output, 10000);
+}
@@ -0,0 +1,72 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "TraceReplayer.h"
+
+#include <HostHAL.h>
+
+using namespace SimRacing;
+
+TraceReplayer::TraceReplayer(Stream& in)
+	: reader(in), pending(false), started(false), lastTime(0), clock(0), count(0), mismatches(0)
+{}
+
+bool TraceReplayer::begin() {
+	this->pending = false;
+	this->started = false;
+	this->count = 0;
+	this->mismatches = 0;
+
+	if (!this->reader.begin()) return false;
+	this->fetch();
+	return true;
+}
+
+void TraceReplayer::fetch() {
+	this->pending = this->reader.read(this->next);
+}
+
+uint16_t TraceReplayer::onRead(TraceSource source, PinNum pin, uint16_t value) {
+	if (!this->pending || this->next.source != source || this->next.pin != pin) {
+		this->mismatches++;
+		return value;
+	}
+
+	// follow the recorded time. The first record syncs the clock,
+	// after which the recorded intervals are added so that a trace
+	// longer than the 32-bit timestamps still moves forwards.
+	if (!this->started) {
+		this->clock = this->next.time;
+		this->started = true;
+	}
+	else {
+		this->clock += (uint32_t) (this->next.time - this->lastTime);
+	}
+	this->lastTime = this->next.time;
+	HostHAL::setMicros(this->clock);
+
+	const uint16_t recorded = this->next.value;
+	this->count++;
+	this->fetch();
+	return recorded;
+}
@@ -0,0 +1,128 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+* @file TraceReplayer.h
+* @brief Replays a recorded trace of raw inputs through the library on the
+*        host, with the simulated clock following the recorded timestamps
+*/
+
+#ifndef SIM_RACING_HOST_TRACE_REPLAYER_H
+#define SIM_RACING_HOST_TRACE_REPLAYER_H
+
+#include <SimRacing.h>
+
+#include <vector>
+
+#if !SIM_RACING_TRACE
+#error "The trace replayer needs the library built with SIM_RACING_TRACE"
+#endif
+
+/**
+* @brief In-memory byte buffer, for writing a trace and reading it back
+*/
+class MemoryStream : public Stream {
+public:
+	MemoryStream() {}
+	MemoryStream(const std::vector<uint8_t>& data) : data(data) {}
+
+	size_t write(uint8_t c) override { this->data.push_back(c); return 1; }
+	using Print::write;
+
+	int available() override { return (int) (this->data.size() - this->pos); }
+	int read() override { return (this->pos < this->data.size()) ? this->data[this->pos++] : -1; }
+	int peek() override { return (this->pos < this->data.size()) ? this->data[this->pos] : -1; }
+
+	/** Moves the read position back to the start of the buffer */
+	void rewind() { this->pos = 0; }
+
+	/** Gets the contents of the buffer */
+	const std::vector<uint8_t>& getData() const { return this->data; }
+
+private:
+	std::vector<uint8_t> data;
+	size_t pos = 0;
+};
+
+/**
+* @brief Feeds the library recorded values in place of the hardware
+*
+* Each read the library makes is matched against the next record in the
+* trace. If they're for the same input, the recorded value is used and
+* the simulated clock is set to the recorded time. Since the library is
+* deterministic for the same inputs and times, it makes the same reads in
+* the same order as when the trace was recorded.
+*
+* If a read doesn't match (e.g. the sketch is not the one that recorded
+* the trace) it's counted as a mismatch and the hardware value is used.
+*/
+class TraceReplayer : public SimRacing::TraceHook {
+public:
+	/**
+	* Class constructor
+	*
+	* @param in the input to read the trace from
+	*/
+	TraceReplayer(Stream& in);
+
+	/**
+	* Starts replaying a trace, checking the header
+	*
+	* @return 'true' if the trace is valid, 'false' otherwise
+	*/
+	bool begin();
+
+	/** @copydoc SimRacing::TraceHook::onRead() */
+	uint16_t onRead(SimRacing::TraceSource source, SimRacing::PinNum pin, uint16_t value) override;
+
+	/**
+	* Checks whether every record in the trace has been replayed
+	*
+	* @return 'true' if the trace is finished, 'false' otherwise
+	*/
+	bool done() const { return !this->pending; }
+
+	/** Gets the number of records replayed */
+	unsigned long getCount() const { return this->count; }
+
+	/** Gets the number of reads that didn't match the next record */
+	unsigned long getMismatches() const { return this->mismatches; }
+
+	/** Checks whether the trace was valid up to where it was read */
+	bool isValid() const { return this->reader.isValid(); }
+
+private:
+	/** Reads the next record from the trace, if there is one */
+	void fetch();
+
+	SimRacing::TraceReader reader;           ///< decoder for the trace
+	SimRacing::TraceReader::Record next;     ///< the next record to replay
+	bool pending;                            ///< whether 'next' holds a record
+	bool started;                            ///< whether the clock has been synced to the trace
+	uint32_t lastTime;                       ///< recorded time of the last record replayed
+	unsigned long clock;                     ///< simulated time of the last record replayed
+	unsigned long count;                     ///< number of records replayed
+	unsigned long mismatches;                ///< number of reads that didn't match the trace
+};
+
+#endif
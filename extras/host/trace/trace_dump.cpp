@@ -0,0 +1,88 @@
+/*
+ *  Project     Sim Racing Library for Arduino
+ *  @author     David Madison
+ *  @link       github.com/dmadison/Sim-Racing-Arduino
+ *  @license    LGPLv3 - Copyright (c) 2022 David Madison
+ *
+ *  This file is part of the Sim Racing Library for Arduino.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+* Prints a binary trace recorded by SimRacing::TraceRecorder as text, one
+* read per line, followed by a summary.
+*
+* Usage: trace_dump <file>
+*/
+
+#include <SimRacing.h>
+#include <TraceReplayer.h>
+
+#include <stdio.h>
+
+#include <fstream>
+#include <iterator>
+
+using namespace SimRacing;
+
+static const char* sourceName(TraceSource source) {
+	switch (source) {
+	case(TraceSource::Analog): return "analog";
+	case(TraceSource::Pin): return "pin";
+	case(TraceSource::ShiftRegisters): return "shift";
+	}
+	return "?";
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <file>\n", argv[0]);
+		return 2;
+	}
+
+	std::ifstream file(argv[1], std::ios::binary);
+	if (!file) {
+		fprintf(stderr, "could not open '%s'\n", argv[1]);
+		return 2;
+	}
+	const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	MemoryStream stream(data);
+	TraceReader reader(stream);
+	if (!reader.begin()) {
+		fprintf(stderr, "not a trace, or an unsupported version\n");
+		return 1;
+	}
+
+	TraceReader::Record rec;
+	unsigned long count = 0;
+	uint32_t first = 0, last = 0;
+
+	while (reader.read(rec)) {
+		printf("%10lu  %-6s %3d  %5u\n", (unsigned long) rec.time, sourceName(rec.source), rec.pin, rec.value);
+		if (count == 0) first = rec.time;
+		last = rec.time;
+		count++;
+	}
+
+	printf("# %lu reads, %lu bytes, %.3f s\n", count, (unsigned long) data.size(), (last - first) / 1e6);
+
+	if (!reader.isValid()) {
+		fprintf(stderr, "trace is invalid after %lu reads\n", count);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+#
+#  Project     Sim Racing Library for Arduino
+#  @author     David Madison
+#  @link       github.com/dmadison/Sim-Racing-Arduino
+#  @license    LGPLv3 - Copyright (c) 2022 David Madison
+#
+#  Compiles a sketch with floating point and with fixed point calibration
+#  math (SIM_RACING_FIXED_POINT 0 and 1), and prints avr-size for each.
+#
+#  Requires arduino-cli with the 'arduino:avr' core installed, and the
+#  library in the Arduino libraries folder (as in the CI workflow).
+#
+#  Usage: extras/tools/size_report.sh [sketch] [fqbn]
+#
+
+set -euo pipefail
+
+repo="$(cd "$(dirname "${BASH_SOURCE[0]}")/../.." && pwd)"
+sketch="${1:-$repo/examples/Benchmarks/CalibrationTiming}"
+fqbn="${2:-arduino:avr:leonardo}"
+
+# avr-size comes with the core's toolchain, which isn't on the path by default
+size="${AVR_SIZE:-$(command -v avr-size || find "$HOME/.arduino15/packages/arduino/tools/avr-gcc" -name avr-size -type f | head -n 1)}"
+if [ -z "$size" ]; then
+	echo "avr-size not found, set AVR_SIZE to its path" >&2
+	exit 1
+fi
+
+build="$(mktemp -d)"
+trap 'rm -rf "$build"' EXIT
+
+for fixed in 0 1; do
+	out="$build/fixed$fixed"
+	arduino-cli compile --fqbn "$fqbn" \
+		--build-property "compiler.cpp.extra_flags=-DSIM_RACING_FIXED_POINT=$fixed" \
+		--output-dir "$out" "$sketch" > /dev/null
+
+	elf="$(find "$out" -name '*.elf' | head -n 1)"
+	echo "SIM_RACING_FIXED_POINT=$fixed"
+	"$size" "$elf"
+	echo
+done
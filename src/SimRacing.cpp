@@ -22,12 +22,15 @@
 
 #include "SimRacing.h"
 
+#include <SPI.h>
+
 /**
 * @file SimRacing.cpp
 * @brief Source file for the Sim Racing Library
 */
 
 namespace SimRacing {
+inline namespace SIM_RACING_CONFIG {
 
 #if defined(__AVR_ATmega32U4__) || defined(SIM_RACING_DOXYGEN)
 
@@ -126,6 +129,72 @@ static constexpr PinNum sanitizePin(PinNum pin) {
 }
 
 
+/**
+* Disables interrupts for as long as it's in scope, and then restores the
+* previous interrupt state. Unlike a bare noInterrupts() / interrupts()
+* pair, this is safe to use from an ISR or inside another critical section.
+*
+* On AVR this saves and restores SREG. On other platforms there is no
+* portable way to read the interrupt state, so this falls back to
+* noInterrupts() / interrupts().
+*/
+class InterruptLock {
+public:
+	InterruptLock()
+#if defined(__AVR__)
+		: sreg(SREG)
+	{
+		cli();
+	}
+	~InterruptLock() { SREG = sreg; }
+#else
+	{
+		noInterrupts();
+	}
+	~InterruptLock() { interrupts(); }
+#endif
+
+	InterruptLock(const InterruptLock&) = delete;
+	InterruptLock& operator=(const InterruptLock&) = delete;
+
+private:
+#if defined(__AVR__)
+	const uint8_t sreg;  ///< Saved status register, with the interrupt flag
+#endif
+};
+
+
+#if SIM_RACING_TRACE
+static TraceHook* traceHook = nullptr;  ///< hook called on every raw input read
+
+void setTraceHook(TraceHook* hook) {
+	traceHook = hook;
+}
+
+TraceHook* getTraceHook() {
+	return traceHook;
+}
+
+/**
+* Passes a raw input value through the trace hook, if there is one
+*
+* @param source the type of input
+* @param pin    the pin the input was read from
+* @param value  the value read from the hardware
+*
+* @return the value for the library to use
+*/
+static uint16_t traceRead(TraceSource source, PinNum pin, uint16_t value) {
+	if (traceHook == nullptr) return value;
+	return traceHook->onRead(source, pin, value);
+}
+
+#define SIM_RACING_TRACE_READ(source, pin, value) traceRead(TraceSource::source, (pin), (value))
+#else
+#define SIM_RACING_TRACE_READ(source, pin, value) (value)
+#endif
+
+
 /**
 * Invert an input value so it's at the same relative position
 * at the other side of an input range.
@@ -175,15 +244,74 @@ static long remap(long value, long inMin, long inMax, long outMin, long outMax)
 
 
 /**
-* Filters a floating point value to a valid percentile range (0-1)
+* Filters a fraction to a valid percentile range (0-1)
 * 
 * @param pct the input value
 * @return the input value limited to 0-1
 */
-static float floatPercent(float pct) {
+static Fraction clampFraction(Fraction pct) {
+#if SIM_RACING_FIXED_POINT
+	return pct;  // fixed point fractions are always in range
+#else
 	if (pct < 0.0) pct = 0.0;
 	else if (pct > 1.0) pct = 1.0;
 	return pct;
+#endif
+}
+
+/**
+* Scales a value by a fraction (0-1)
+*
+* With fixed point math the result is rounded to the nearest count, which
+* matches the floating point result within one count once it's converted
+* back to an integer.
+*
+* @param value the value to scale
+* @param pct   the fraction to scale by
+* @return the scaled value
+*/
+#if SIM_RACING_FIXED_POINT
+static long scaleFraction(long value, Fraction pct) {
+	if (value < 0) return -scaleFraction(-value, pct);
+	return ((unsigned long) value * pct.value + 0x8000) >> 16;  // Q0.16, rounded
+}
+#else
+static float scaleFraction(long value, Fraction pct) {
+	return (float) value * pct;
+}
+#endif
+
+/**
+* Prints a fraction (0-1) to a given Print interface, with two decimals
+*
+* @param out the Print interface to write to
+* @param pct the fraction to print
+*/
+static void printFraction(Print& out, Fraction pct) {
+#if SIM_RACING_FIXED_POINT
+	const uint8_t hundredths = ((unsigned long) pct.value * 100 + 0x8000) >> 16;  // rounded
+	out.print(hundredths / 100);
+	out.print('.');
+	if (hundredths % 100 < 10) out.print('0');
+	out.print(hundredths % 100);
+#else
+	out.print(pct);
+#endif
+}
+
+/**
+* Scales a value from a 10-bit ADC to the configured ADC resolution. This is
+* used for the built-in device calibrations, which were measured on 10-bit ADCs.
+*
+* @param value the 10-bit ADC value
+* @return the value at the resolution set by SIM_RACING_ADC_BITS
+*/
+static constexpr AnalogValue fromTenBit(AnalogValue value) {
+#if SIM_RACING_ADC_BITS >= 10
+	return value << (SIM_RACING_ADC_BITS - 10);
+#else
+	return value >> (10 - SIM_RACING_ADC_BITS);
+#endif
 }
 
 /**
@@ -208,41 +336,94 @@ static void waitClient(Stream& client) {
 	while (client.peek() == -1) { delay(1); }  // wait for a new byte (using delay to avoid watchdog)
 }
 
+#if SIM_RACING_FIXED_POINT
 /**
-* Read a floating point percentage value from a given Stream interface.
+* Parses a decimal fraction (0-1) from a String without floating point math.
+* Digits past four decimal places are ignored.
+*
+* @param text the String to parse, e.g. "0.75"
+* @param out  the parsed fraction, if valid
+* @return 'true' if the String is a fraction between 0 and 1, 'false' otherwise
+*/
+static bool parseFraction(const String& text, Fraction& out) {
+	unsigned long num = 0;  // decimal digits
+	unsigned long den = 1;  // power of ten for the decimal places
+	bool point = false;
+	bool digits = false;
+
+	for (unsigned int i = 0; i < text.length(); ++i) {
+		const char c = text[i];
+
+		if (c >= '0' && c <= '9') {
+			if (den < 10000) {
+				num = num * 10 + (c - '0');
+				if (point) den *= 10;
+			}
+			if (num > den) return false;  // greater than 1
+			digits = true;
+		}
+		else if (c == '.' && !point) {
+			point = true;
+		}
+		else {
+			return false;  // not a number
+		}
+	}
+	if (!digits) return false;
+
+	const unsigned long q = ((num << 16) + den / 2) / den;  // Q0.16, rounded
+	out.value = (q > 0xFFFF) ? 0xFFFF : q;
+	return true;
+}
+#endif
+
+/**
+* Read a percentage value from a given Stream interface as a Fraction.
 * 
-* The user can skip setting a floating point value by sending the character
-* 'n' when prompted. If 'n' is received the value is left unchanged.
+* The user can skip setting a value by sending the character 'n' when
+* prompted. If 'n' is received the value is left unchanged.
 * 
 * Note that this does *not* handle non-numeric strings. If a non-numeric string
-* is sent the parseFloat() function will time out and default to "0.0".
+* is sent the parseFloat() function will time out and default to "0.0". With
+* fixed point math a non-numeric string is rejected, and the user is prompted
+* again.
 * 
-* @param value the floating point input, passed by reference
+* @param value the fraction input, passed by reference
 * @param client the Stream client to read from and write messages to
 */
-static void readFloat(float& value, Stream& client) {
+static void readFraction(Fraction& value, Stream& client) {
 	client.print("(to skip this step and go with the default value of '");
-	client.print(value);
+	printFraction(client, value);
 	client.print("', send 'n')");
 	client.println();
 
 	waitClient(client);
 	if (client.peek() == 'n') return;  // skip this step
 
-	float input;
+	Fraction input;
 
 	while (true) {
 		client.setTimeout(200);
-		input = client.parseFloat();
 
+#if SIM_RACING_FIXED_POINT
+		String text = client.readStringUntil('\n');
+		text.trim();
+		if (parseFraction(text, input)) {
+#else
+		input = client.parseFloat();
 		if (input >= 0.0 && input <= 1.0) {
+#endif
 			client.print(F("Set the new value to '"));
-			client.print(input);
+			printFraction(client, input);
 			client.println("'");
 			break;
 		}
 		client.print(F("Input '"));
+#if SIM_RACING_FIXED_POINT
+		client.print(text);
+#else
 		client.print(input);
+#endif
 		client.print(F("' not within acceptable range (0.0 - 1.0). Please try again."));
 		client.println();
 
@@ -253,13 +434,238 @@ static void readFloat(float& value, Stream& client) {
 }
 
 
+//#########################################################
+//                       FastPin                          #
+//#########################################################
+
+#if defined(__AVR__)
+/**
+* Stand-in register for unused pins, so that reads and writes through
+* them are harmless without a check in the fast path. With a zero mask
+* reads are always LOW and writes never change it.
+*/
+static volatile uint8_t UnusedPinRegister = 0;
+
+FastPin::FastPin(PinNum pin)
+	: inputReg(&UnusedPinRegister), outputReg(&UnusedPinRegister), mask(0)
+{
+	if (pin == UnusedPin) return;
+
+	const uint8_t port = digitalPinToPort(pin);
+	if (port == NOT_A_PIN) return;
+
+	this->inputReg  = portInputRegister(port);
+	this->outputReg = portOutputRegister(port);
+	this->mask      = digitalPinToBitMask(pin);
+}
+#else
+FastPin::FastPin(PinNum pin)
+	: pin(pin)
+{}
+#endif
+
+//#########################################################
+//                   ShiftRegisterBus                     #
+//#########################################################
+
+ShiftRegisterBus::ShiftRegisterBus(PinNum pinLatch, PinNum pinClock, PinNum pinData)
+	:
+	pinLatch(sanitizePin(pinLatch)), pinClock(sanitizePin(pinClock)), pinData(sanitizePin(pinData)),
+	fastLatch(this->pinLatch), fastClock(this->pinClock), fastData(this->pinData),
+	enabled(false),
+	useSPI(false)  // bit-bang by default
+{}
+
+bool ShiftRegisterBus::isValid() const {
+	return
+		this->pinData  != UnusedPin &&
+		this->pinLatch != UnusedPin &&
+		this->pinClock != UnusedPin;
+}
+
+void ShiftRegisterBus::setPinModes(bool enabled) {
+	// check if pins are valid. if one or more pins is unused,
+	// this isn't going to work and we shouldn't bother setting
+	// any of the pin states
+	if (!this->isValid()) return;
+
+	// set up data pin to read from regardless
+	pinMode(this->pinData, INPUT);
+
+	// enabled = drive the output pins
+	if (enabled) {
+		// note: writing the output before setting the
+		// pin mode so that we don't accidentally drive
+		// the wrong direction momentarily
+
+		// set latch pin as output, HIGH on idle
+		digitalWrite(this->pinLatch, HIGH);
+		pinMode(this->pinLatch, OUTPUT);
+
+		// set clock pin as output, LOW on idle
+		digitalWrite(this->pinClock, LOW);
+		pinMode(this->pinClock, OUTPUT);
+
+		// hand the clock and data pins over to the SPI peripheral
+		if (this->useSPI) {
+			SPI.begin();
+		}
+	}
+
+	// disabled = leave output pins as high-z
+	else {
+		// take the clock and data pins back from the SPI peripheral
+		if (this->enabled && this->useSPI) {
+			SPI.end();
+		}
+
+		// note: setting the mode before writing the
+		// output for the same reason; changing in
+		// high-z mode is safer
+
+		// set latch pin as high impedance, with pull-up
+		pinMode(this->pinLatch, INPUT);
+		digitalWrite(this->pinLatch, HIGH);
+
+		// set clock pin as high impedance, no pull-up
+		pinMode(this->pinClock, INPUT);
+		digitalWrite(this->pinClock, LOW);
+	}
+
+	this->enabled = enabled;
+}
+
+bool ShiftRegisterBus::setHardwareSPI(bool enabled) {
+	// hardware SPI can only be used if the registers are wired
+	// to the SPI clock and SPI input pins
+	if (enabled) {
+#if defined(PIN_SPI_SCK) && defined(PIN_SPI_MISO)
+		enabled = (this->pinClock == PIN_SPI_SCK && this->pinData == PIN_SPI_MISO);
+#else
+		enabled = false;
+#endif
+	}
+
+	if (enabled == this->useSPI) return this->useSPI;  // no change
+
+	// if the pins are currently driven, switch the
+	// SPI peripheral on or off to match
+	if (this->enabled) {
+		this->setPinModes(0);
+		this->useSPI = enabled;
+		this->setPinModes(1);
+	}
+	else {
+		this->useSPI = enabled;
+	}
+
+	return this->useSPI;
+}
+
+bool ShiftRegisterBus::readData() const {
+	if (!this->enabled) return false;
+	return this->fastData.read();
+}
+
+bool ShiftRegisterBus::readBits(uint8_t* data, uint8_t bits, uint8_t fill) {
+	const uint8_t length = (bits + 7) / 8;
+
+	// if the pin outputs are not set, quit (no data)
+	if (!this->enabled) {
+		for (uint8_t i = 0; i < length; ++i) {
+			data[i] = 0x00;
+		}
+		return false;
+	}
+
+	// pulse shift register latch from high to low to high, 12 us
+	// (this timing is *completely* arbitrary, but it's nice to have
+	//  *some* delay so that much faster MCUs don't blow through it)
+	this->fastLatch.write(LOW);
+	delayMicroseconds(12);
+	this->fastLatch.write(HIGH);
+	delayMicroseconds(12);
+
+	// with hardware SPI, the clock idles low and data is sampled on
+	// the rising edge (mode 0), matching the bit-banged reads below.
+	// The data is read one byte at a time, MSB-first.
+	if (this->useSPI) {
+		SPI.beginTransaction(SPISettings(SPIClockSpeed, MSBFIRST, SPI_MODE0));
+		for (uint8_t i = 0; i < length; ++i) {
+			data[i] = SPI.transfer(fill);
+		}
+		SPI.endTransaction();
+
+		// discard the bits past the end of the read
+		if (bits % 8) {
+			data[length - 1] &= (uint8_t) (0xFF << (8 - (bits % 8)));
+		}
+	}
+
+	// clock is pulsed from LOW to HIGH on every bit,
+	// and then left to idle low
+	else {
+		for (uint8_t i = 0; i < length; ++i) {
+			const uint8_t count = (bits - (i * 8) < 8) ? (bits - (i * 8)) : 8;
+
+			uint8_t byte = 0x00;
+			for (uint8_t bit = 0; bit < count; ++bit) {
+				this->fastClock.write(LOW);
+				byte = (byte << 1) | this->fastData.read();  // MSB-first
+				this->fastClock.write(HIGH);
+				delayMicroseconds(6);
+			}
+			data[i] = byte << (8 - count);  // align the first bit to the MSB
+		}
+		this->fastClock.write(LOW);
+	}
+
+	return true;
+}
+
+//#########################################################
+//                        Frame                           #
+//#########################################################
+
+Frame::Frame()
+	: timeMicros(micros()), timeMillis(timeMicros / 1000), remainder(timeMicros % 1000), count(0)
+{}
+
+void Frame::tick() {
+	const unsigned long now = micros();
+
+	// keep a millisecond count from the elapsed micros, so it
+	// doesn't need a second clock read and stays wrap-safe
+	unsigned long elapsed = (now - this->timeMicros) + this->remainder;
+
+	// frames are usually no more than a few milliseconds apart, so
+	// counting off the milliseconds is cheaper than a 32-bit division
+	// (done in software on AVR). Long gaps, such as the first frame
+	// after setup(), fall back to dividing.
+	const unsigned long MaxSteps = 8;
+	if (elapsed < MaxSteps * 1000) {
+		while (elapsed >= 1000) {
+			elapsed -= 1000;
+			this->timeMillis++;
+		}
+	}
+	else {
+		this->timeMillis += elapsed / 1000;
+		elapsed %= 1000;
+	}
+	this->remainder = elapsed;
+
+	this->timeMicros = now;
+	this->count++;
+}
+
 //#########################################################
 //                  DeviceConnection                      #
 //#########################################################
 
 DeviceConnection::DeviceConnection(PinNum pin, bool activeLow, unsigned long detectTime)
 	:
-	pin(sanitizePin(pin)), inverted(activeLow), stablePeriod(detectTime),  // constants(ish)
+	pin(sanitizePin(pin)), fastPin(this->pin), inverted(activeLow), stablePeriod(detectTime),  // constants(ish)
 
 	/* Assume we're connected on first call
 	*/
@@ -279,7 +685,11 @@ DeviceConnection::DeviceConnection(PinNum pin, bool activeLow, unsigned long det
 	* read as being already stable. Again, this will make the class return
 	* 'present' as soon as the board starts up
 	*/
-	lastChange(millis() - detectTime)
+	lastChange(millis() - detectTime),
+
+	/* Polled by default, see setInterruptMode()
+	*/
+	interruptMode(false), edgePending(false), edgeState(pinState), edgeTime(0)
 
 {
 	if (pin != UnusedPin) {
@@ -287,15 +697,85 @@ DeviceConnection::DeviceConnection(PinNum pin, bool activeLow, unsigned long det
 	}
 }
 
+DeviceConnection::DeviceConnection(const DeviceConnection& other)
+	:
+	pin(other.pin), fastPin(other.pin), inverted(other.inverted), stablePeriod(other.stablePeriod),
+	state(other.state), pinState(other.pinState), lastChange(other.lastChange),
+
+	/* The copy isn't in the interrupt list yet, so it starts polled
+	* and is registered separately below
+	*/
+	interruptMode(false), edgePending(false), edgeState(other.pinState), edgeTime(0)
+{
+	if (other.interruptMode) {
+		setInterruptMode(true);
+	}
+}
+
+DeviceConnection& DeviceConnection::operator=(const DeviceConnection& other) {
+	if (this == &other) return *this;
+
+	setInterruptMode(false);  // leave the list before changing pins
+
+	pin = other.pin;
+	fastPin = FastPin(other.pin);
+	inverted = other.inverted;
+	stablePeriod = other.stablePeriod;
+
+	state = other.state;
+	pinState = other.pinState;
+	lastChange = other.lastChange;
+
+	edgePending = false;
+	edgeState = other.pinState;
+	edgeTime = 0;
+
+	if (other.interruptMode) {
+		setInterruptMode(true);
+	}
+	return *this;
+}
+
+DeviceConnection::~DeviceConnection() {
+	setInterruptMode(false);  // don't leave a dangling pointer for the ISR
+}
+
 void DeviceConnection::poll() {
-	const bool newState = readPin();
+	pollFrame(nullptr);
+}
 
-	if (newState == HIGH && state == ConnectionState::Connected) return;  // short circuit, already connected
+void DeviceConnection::poll(const Frame& frame) {
+	pollFrame(&frame);
+}
+
+void DeviceConnection::pollFrame(const Frame* frame) {
+	bool newState;
+	bool edge = false;
+	unsigned long edgeTimestamp = 0;
+
+	if (interruptMode) {
+		// the interrupt flags every pin change, so if there are none
+		// and the state is settled there's nothing to check
+		if (!edgePending && (state == ConnectionState::Connected || state == ConnectionState::Disconnected)) return;
+
+		InterruptLock lock;
+		edge = edgePending;
+		newState = edgeState;
+		edgeTimestamp = edgeTime;
+		edgePending = false;
+	}
+	else {
+		newState = readPin();
+		if (newState == HIGH && state == ConnectionState::Connected) return;  // short circuit, already connected
+	}
 
-	// check if the pin changed. if it did, record the time
-	if (pinState != newState) {
+	// check if the pin changed. if it did, record the time. In interrupt
+	// mode this also catches the pin bouncing back between polls, which
+	// restarts the stable period.
+	if (pinState != newState || edge) {
 		pinState = newState;
-		lastChange = millis();
+		if (edge) lastChange = edgeTimestamp;
+		else lastChange = frame ? frame->getMillis() : millis();
 
 		// rising, we just connected
 		if (pinState == HIGH) {
@@ -311,8 +791,10 @@ void DeviceConnection::poll() {
 	else {
 		// check stable connection (over time)
 		if (pinState == HIGH) {
-			const unsigned long now = millis();
-			if (now - lastChange >= stablePeriod) {
+			// signed, as an interrupt timestamp can be a hair
+			// newer than the frame time
+			const unsigned long now = frame ? frame->getMillis() : millis();
+			if ((long) (now - lastChange) >= (long) stablePeriod) {
 				state = ConnectionState::Connected;
 			}
 		}
@@ -345,12 +827,479 @@ void DeviceConnection::setStablePeriod(unsigned long t) {
 	}
 }
 
-bool DeviceConnection::readPin() const {
-	if (pin == UnusedPin) return HIGH;  // if no pin is set, we're always connected
-	const bool state = digitalRead(pin);
-	return inverted ? !state : state;
+bool DeviceConnection::readPin() const {
+	if (pin == UnusedPin) return HIGH;  // if no pin is set, we're always connected
+	const bool state = SIM_RACING_TRACE_READ(Pin, pin, fastPin.read());
+	return inverted ? !state : state;
+}
+
+DeviceConnection* DeviceConnection::interruptList[DeviceConnection::MaxInterrupts] = { nullptr };
+
+/**
+* Enables or disables the interrupt for changes on a pin
+*
+* On AVR this uses the pin change interrupt, and the ISR must be defined
+* by the sketch. Elsewhere this attaches DeviceConnection::handlePinChange()
+* as an external interrupt.
+*
+* @param pin     the pin to set the interrupt for (Arduino numbering)
+* @param enabled 'true' to enable the interrupt, 'false' to disable it
+*
+* @return 'true' if the interrupt was set, 'false' if the pin doesn't
+*         support it
+*/
+static bool setPinInterrupt(PinNum pin, bool enabled) {
+#if defined(digitalPinToPCICR) && defined(digitalPinToPCMSK)
+	volatile uint8_t* pcicr = digitalPinToPCICR(pin);
+	volatile uint8_t* pcmsk = digitalPinToPCMSK(pin);
+	if (pcicr == nullptr || pcmsk == nullptr) return false;
+
+	if (enabled) {
+		*pcmsk |= (1 << digitalPinToPCMSKbit(pin));
+		*pcicr |= (1 << digitalPinToPCICRbit(pin));
+	}
+	else {
+		// the bank is left enabled, as other pins may be using it
+		*pcmsk &= ~(1 << digitalPinToPCMSKbit(pin));
+	}
+	return true;
+#elif defined(digitalPinToInterrupt) && defined(NOT_AN_INTERRUPT)
+	const int irq = digitalPinToInterrupt(pin);
+	if (irq == NOT_AN_INTERRUPT) return false;
+
+	if (enabled) attachInterrupt(irq, DeviceConnection::handlePinChange, CHANGE);
+	else detachInterrupt(irq);
+	return true;
+#else
+	(void) pin;
+	(void) enabled;
+	return false;
+#endif
+}
+
+bool DeviceConnection::setInterruptMode(bool enabled) {
+	if (enabled == interruptMode) return true;  // already set
+	if (pin == UnusedPin) return !enabled;     // nothing to detect
+
+	if (enabled) {
+		uint8_t slot = 0;
+		while (slot < MaxInterrupts && interruptList[slot] != nullptr) slot++;
+		if (slot >= MaxInterrupts) return false;  // list is full
+
+		// seed the interrupt state, flagging a change if the pin
+		// changed since we last polled it
+		{
+			InterruptLock lock;
+			edgeState = readPin();
+			edgeTime = millis();
+			edgePending = (edgeState != pinState);
+			interruptList[slot] = this;
+		}
+
+		if (!setPinInterrupt(pin, true)) {
+			interruptList[slot] = nullptr;
+			return false;
+		}
+	}
+	else {
+		bool shared = false;  // whether another connection uses the same pin
+		{
+			InterruptLock lock;
+			for (uint8_t i = 0; i < MaxInterrupts; ++i) {
+				if (interruptList[i] == this) interruptList[i] = nullptr;
+				else if (interruptList[i] != nullptr && interruptList[i]->pin == pin) shared = true;
+			}
+		}
+
+		// leave the pin interrupt on if another connection still needs it
+		if (!shared) {
+			setPinInterrupt(pin, false);
+		}
+	}
+
+	interruptMode = enabled;
+	return true;
+}
+
+void DeviceConnection::handlePinChange() {
+	for (uint8_t i = 0; i < MaxInterrupts; ++i) {
+		if (interruptList[i] != nullptr) {
+			interruptList[i]->recordPinChange();
+		}
+	}
+}
+
+void DeviceConnection::recordPinChange() {
+	// the interrupt is shared with other pins, so check ours changed
+	const bool newState = readPin();
+	if (newState == edgeState) return;
+
+	edgeState = newState;
+	edgeTime = millis();
+	edgePending = true;
+}
+
+//#########################################################
+//                    AnalogSampler                       #
+//#########################################################
+
+bool AnalogSampler::running = false;
+bool AnalogSampler::interruptMode = false;
+uint8_t AnalogSampler::numChannels = 0;
+volatile uint8_t AnalogSampler::current = 0;
+uint8_t AnalogSampler::step = 0;
+uint8_t AnalogSampler::order[AnalogSampler::MaxChannels];
+uint8_t AnalogSampler::settling = AnalogSampler::DefaultSettling;
+uint8_t AnalogSampler::discards = 0;
+volatile unsigned long AnalogSampler::scanCount = 0;
+PinNum AnalogSampler::pins[AnalogSampler::MaxChannels];
+uint8_t AnalogSampler::muxes[AnalogSampler::MaxChannels];
+volatile uint16_t AnalogSampler::results[AnalogSampler::MaxChannels];
+uint8_t AnalogSampler::oversampling[AnalogSampler::MaxChannels];
+uint16_t AnalogSampler::accumulator = 0;
+uint8_t AnalogSampler::conversions = 0;
+
+/**
+* Reads an analog pin using analogRead(), oversampling and decimating
+* the result for extra resolution
+*
+* @param pin       the analog pin to read (Arduino numbering)
+* @param extraBits the number of bits of extra resolution, 0-3
+* @returns the ADC value for the pin, scaled up by 2^extraBits
+*/
+static AnalogValue analogReadOversampled(PinNum pin, uint8_t extraBits) {
+	if (extraBits == 0) return analogRead(pin);
+
+	const uint8_t count = 1 << (2 * extraBits);  // 4 conversions per bit
+
+	uint32_t sum = 0;
+	for (uint8_t i = 0; i < count; ++i) {
+		sum += analogRead(pin);
+	}
+	return sum >> extraBits;
+}
+
+#if defined(__AVR__) && defined(ADCSRA) && defined(ADMUX) && (SIM_RACING_ADC_BITS == 10)
+
+/**
+* Converts an analog pin number to its ADC multiplexer channel, following
+* the same conventions as the Arduino core's analogRead()
+*
+* @param pin the analog pin number (Arduino numbering)
+* @returns the ADC channel number
+*/
+static uint8_t pinToADCChannel(PinNum pin) {
+	if (pin >= A0) pin -= A0;  // allow for channel or pin numbers
+#if defined(analogPinToChannel)
+	return analogPinToChannel(pin);
+#else
+	return pin;
+#endif
+}
+
+/**
+* Selects an ADC channel and starts a single conversion
+*
+* @param mux the ADC channel to convert
+*/
+static void startADCConversion(uint8_t mux) {
+#if defined(ADCSRB) && defined(MUX5)
+	ADCSRB = (ADCSRB & ~(1 << MUX5)) | (((mux >> 3) & 0x01) << MUX5);
+#endif
+	ADMUX = (DEFAULT << 6) | (mux & 0x07);
+	ADCSRA |= (1 << ADSC);
+}
+
+/**
+* Waits for the in-progress ADC conversion (if any) to finish, and clears
+* the interrupt flag so that the result is discarded
+*/
+static void finishADCConversion() {
+	while (ADCSRA & (1 << ADSC)) {}  // wait for conversion to complete
+	ADCSRA |= (1 << ADIF);  // clear the flag by writing a '1'
+}
+
+/**
+* Performs a blocking conversion on an ADC channel, oversampling and
+* decimating the result for extra resolution
+*
+* @param mux       the ADC channel to convert
+* @param extraBits the number of bits of extra resolution, 0-3
+* @param discards  the number of conversions to throw away first, while
+*                  the input settles after switching channels
+* @returns the ADC value, scaled up by 2^extraBits
+*/
+static uint16_t convertADCChannel(uint8_t mux, uint8_t extraBits, uint8_t discards) {
+	for (uint8_t i = 0; i < discards; ++i) {
+		startADCConversion(mux);
+		finishADCConversion();
+	}
+
+	const uint8_t count = 1 << (2 * extraBits);  // 4 conversions per bit
+
+	uint16_t sum = 0;  // 64 conversions * 1023 max still fits
+	for (uint8_t i = 0; i < count; ++i) {
+		startADCConversion(mux);
+		finishADCConversion();
+		sum += ADC;
+	}
+	return sum >> extraBits;
+}
+
+void AnalogSampler::begin(bool useInterrupt) {
+	if (running) end();
+
+	// seed the results for any channels registered before we started,
+	// so that the first reads don't return stale values
+	for (uint8_t i = 0; i < numChannels; ++i) {
+		results[i] = convertADCChannel(muxes[i], oversampling[i], settling);
+	}
+
+	interruptMode = useInterrupt;
+	step = 0;
+	current = order[0];
+	discards = settling;  // the last conversion may have been on any channel
+	accumulator = 0;
+	conversions = 0;
+	scanCount = 0;
+
+	if (interruptMode) ADCSRA |= (1 << ADIE);
+	else ADCSRA &= ~(1 << ADIE);
+
+	running = true;
+
+	// kick off the first conversion. If there are no channels yet, this
+	// will happen when the first one is added
+	if (numChannels > 0) {
+		startADCConversion(muxes[current]);
+	}
+}
+
+void AnalogSampler::end() {
+	if (!running) return;
+
+	const uint8_t sreg = SREG;
+	cli();
+
+	finishADCConversion();
+	ADCSRA &= ~(1 << ADIE);
+	running = false;
+
+	SREG = sreg;
+}
+
+AnalogValue AnalogSampler::read(PinNum pin, uint8_t extraBits) {
+	if (!running) return analogReadOversampled(pin, extraBits);
+
+	// in polled mode, the sampler can only advance when we look at it
+	if (!interruptMode) service();
+
+	for (uint8_t i = 0; i < numChannels; ++i) {
+		if (pins[i] != pin) continue;
+
+		// results are written from the ISR in interrupt mode, so
+		// the 16-bit read needs to be atomic
+		const uint8_t sreg = SREG;
+		cli();
+
+		// if the resolution changed, rescale the last result to match
+		// and restart the sum if the channel is being converted
+		const uint8_t previousBits = oversampling[i];
+		if (extraBits != previousBits) {
+			if (extraBits > previousBits) results[i] = results[i] << (extraBits - previousBits);
+			else results[i] = results[i] >> (previousBits - extraBits);
+
+			oversampling[i] = extraBits;
+
+			if (current == i) {
+				accumulator = 0;
+				conversions = 0;
+			}
+		}
+
+		const AnalogValue value = results[i];
+		SREG = sreg;
+
+		return value;
+	}
+
+	return addChannel(pin, extraBits);
+}
+
+void AnalogSampler::service() {
+	if (!running || numChannels == 0) return;
+	if (ADCSRA & (1 << ADSC)) return;  // conversion still in progress
+
+	// the first conversions after switching channels are skewed
+	// while the input settles, so throw them away
+	if (discards > 0) {
+		discards--;
+		ADCSRA |= (1 << ADSC);
+		return;
+	}
+
+	// when oversampling, keep converting the same channel back-to-back
+	// until all of the conversions have been summed
+	const uint8_t extraBits = oversampling[current];
+	accumulator += ADC;
+
+	if (++conversions < (1 << (2 * extraBits))) {
+		ADCSRA |= (1 << ADSC);  // same channel, no need to switch
+		return;
+	}
+
+	results[current] = accumulator >> extraBits;
+	accumulator = 0;
+	conversions = 0;
+
+	// move on to the next step in the scan table
+	uint8_t next = step + 1;
+	if (next >= numChannels) {
+		next = 0;
+		scanCount++;
+	}
+	step = next;
+
+	// settling is only needed if the multiplexer is switching
+	const uint8_t channel = order[next];
+	discards = (channel != current) ? settling : 0;
+	current = channel;
+
+	startADCConversion(muxes[channel]);
+}
+
+void AnalogSampler::scan() {
+	if (!running || numChannels == 0) return;
+
+	// if the scan is part way through, some of the channels were
+	// converted before this call. Finish it, then do a fresh one.
+	const uint8_t sreg = SREG;
+	cli();
+	const unsigned long start = scanCount;
+	const uint8_t needed = (step == 0 && conversions == 0) ? 1 : 2;
+	SREG = sreg;
+
+	while (getScanCount() - start < needed) {
+		if (!interruptMode) service();
+	}
+}
+
+bool AnalogSampler::addPin(PinNum pin) {
+	for (uint8_t i = 0; i < numChannels; ++i) {
+		if (pins[i] == pin) return true;  // already in the table
+	}
+	if (numChannels >= MaxChannels) return false;
+
+	// if we're running, the channel needs to be seeded now
+	if (running) {
+		addChannel(pin, 0);
+		return true;
+	}
+
+	pins[numChannels] = pin;
+	muxes[numChannels] = pinToADCChannel(pin);
+	results[numChannels] = 0;  // seeded by begin()
+	oversampling[numChannels] = 0;
+	numChannels++;
+
+	planScan();
+	return true;
+}
+
+void AnalogSampler::setSettling(uint8_t n) {
+	const uint8_t sreg = SREG;
+	cli();
+	settling = n;
+	if (discards > n) discards = n;
+	SREG = sreg;
+}
+
+AnalogSampler::ScanStep AnalogSampler::getScanStep(uint8_t n) {
+	if (n >= numChannels) return { UnusedPin, 0, 0 };
+
+	const uint8_t channel = order[n];
+	const uint8_t switching = (numChannels > 1) ? settling : 0;
+	return { pins[channel], switching, (uint8_t) (1 << (2 * oversampling[channel])) };
+}
+
+unsigned long AnalogSampler::getScanCount() {
+	// written from the ISR in interrupt mode, so the read needs to be atomic
+	const uint8_t sreg = SREG;
+	cli();
+	const unsigned long count = scanCount;
+	SREG = sreg;
+	return count;
+}
+
+void AnalogSampler::planScan() {
+	// the channel indices, insertion sorted by multiplexer channel
+	for (uint8_t i = 0; i < numChannels; ++i) {
+		uint8_t j = i;
+		for (; j > 0 && muxes[order[j - 1]] > muxes[i]; --j) {
+			order[j] = order[j - 1];
+		}
+		order[j] = i;
+	}
+
+	// keep converting the same channel if its place in the table moved
+	for (uint8_t i = 0; i < numChannels; ++i) {
+		if (order[i] == current) {
+			step = i;
+			break;
+		}
+	}
+}
+
+AnalogValue AnalogSampler::addChannel(PinNum pin, uint8_t extraBits) {
+	const uint8_t sreg = SREG;
+	cli();
+
+	// the multiplexer can't change mid-conversion, so we need
+	// to wait for (and throw away) the background conversion
+	finishADCConversion();
+
+	const uint8_t mux = pinToADCChannel(pin);
+	const AnalogValue value = convertADCChannel(mux, extraBits, settling);
+
+	// if there's room, add the channel to the list. Otherwise the
+	// pin will keep using a blocking conversion on every read
+	if (numChannels < MaxChannels) {
+		pins[numChannels] = pin;
+		muxes[numChannels] = mux;
+		results[numChannels] = value;
+		oversampling[numChannels] = extraBits;
+		numChannels++;
+
+		planScan();
+	}
+
+	// restart the background conversions where we left off, settling
+	// again as the multiplexer was switched to the new channel
+	discards = settling;
+	startADCConversion(muxes[current]);
+
+	SREG = sreg;
+	return value;
 }
 
+#else
+
+// without direct access to the ADC, the sampler is never started
+// and all reads fall back to the Arduino API
+void AnalogSampler::begin(bool) {}
+void AnalogSampler::end() {}
+AnalogValue AnalogSampler::read(PinNum pin, uint8_t extraBits) { return analogReadOversampled(pin, extraBits); }
+void AnalogSampler::service() {}
+void AnalogSampler::scan() {}
+bool AnalogSampler::addPin(PinNum) { return false; }
+void AnalogSampler::setSettling(uint8_t n) { settling = n; }
+AnalogSampler::ScanStep AnalogSampler::getScanStep(uint8_t) { return { UnusedPin, 0, 0 }; }
+unsigned long AnalogSampler::getScanCount() { return 0; }
+void AnalogSampler::planScan() {}
+AnalogValue AnalogSampler::addChannel(PinNum pin, uint8_t extraBits) { return analogReadOversampled(pin, extraBits); }
+
+#endif  // AVR ADC registers, 10-bit
+
 //#########################################################
 //                     AnalogInput                        #
 //#########################################################
@@ -361,21 +1310,33 @@ AnalogInput::AnalogInput(PinNum pin)
 {
 	if (pin != UnusedPin) {
 		pinMode(pin, INPUT);
+		AnalogSampler::addPin(pin);  // include in the background scan
 	}
+	this->oversampling = 0;  // native ADC resolution by default
+	this->reported = this->position;
+	this->suppressed = 0;
+	setDeadband(0);  // report every change by default
+	updateScaling(AnalogInput::Min, AnalogInput::Max);  // default output range
+	setFilter(FilterNone);  // no filtering by default
 }
 
 bool AnalogInput::read() {
 	bool changed = false;
 
 	if (pin != UnusedPin) {
-		const int previous = this->position;
-		this->position = analogRead(pin);
+		const AnalogValue previous = this->position;
+		const AnalogValue reading = SIM_RACING_TRACE_READ(Analog, pin, AnalogSampler::read(pin, this->oversampling));
+		this->position = applyFilter(reading);
+
+		if (this->adaptive) {
+			updateNoise(abs(this->position - previous));
+		}
 
 		// check if value is different for 'changed' flag
 		if (previous != this->position) {
 
-			const int rMin = isInverted() ? getMax() : getMin();
-			const int rMax = isInverted() ? getMin() : getMax();
+			const AnalogValue rMin = isInverted() ? getMax() : getMin();
+			const AnalogValue rMax = isInverted() ? getMin() : getMax();
 
 			if (
 				// if the previous value was under the minimum range
@@ -390,19 +1351,143 @@ bool AnalogInput::read() {
 				// otherwise, the current value is either within the
 				// range limits *or* it has changed from one extreme
 				// to the other. Either way, mark it changed!
-				changed = true;
+				// (unless the change is too small to report)
+				if (exceedsDeadband()) {
+					this->reported = this->position;
+					changed = true;
+				}
+				else {
+					this->suppressed++;
+				}
 			}
 		}
 	}
 	return changed;
 }
 
+bool AnalogInput::exceedsDeadband() const {
+	const int threshold = getDeadband();
+	if (threshold == 0) return true;  // no deadband, always report
+
+	const AnalogValue rMin = isInverted() ? getMax() : getMin();
+	const AnalogValue rMax = isInverted() ? getMin() : getMax();
+
+	// compare positions within the calibrated range, where they
+	// affect the output of getPosition()
+	const AnalogValue current = constrain(this->position, rMin, rMax);
+	const AnalogValue last = constrain(this->reported, rMin, rMax);
+
+	if (current == last) return false;
+
+	// always report reaching the ends of the range, so
+	// that the axis can be fully released / fully pressed
+	if (current == rMin || current == rMax) return true;
+
+	return abs(current - last) > threshold;
+}
+
+void AnalogInput::updateNoise(AnalogValue delta) {
+	// changes larger than twice the base deadband (plus a margin) are
+	// treated as movement, and are excluded so the axis moving doesn't
+	// inflate the estimate of noise at rest. This uses the base deadband
+	// rather than the widened one, otherwise noise would widen the gate
+	// and let ever larger movements count as noise.
+	const int MovementMargin = 4;
+	if (delta > 2 * this->deadband + MovementMargin) return;
+
+	// moving average of 1/16 per reading. The accumulator holds 16x the
+	// average in 1/16ths of a count, so the fractional bits aren't lost
+	// to truncation and the estimate can decay all the way back down.
+	// Samples are capped so the accumulator can't overflow.
+	const uint16_t sample = (delta > 0xFF) ? 0xFF : (uint16_t) delta;
+	this->noise += (sample << 4) - (this->noise >> 4);
+}
+
+void AnalogInput::setDeadband(uint8_t counts, bool adaptive) {
+	this->deadband = counts;
+	this->adaptive = adaptive;
+	this->noise = 0;
+}
+
+int AnalogInput::getDeadband() const {
+	if (!this->adaptive) return this->deadband;
+
+	// widen by twice the average noise, rounded
+	const uint16_t average = this->noise >> 4;  // in 1/16ths of a count
+	return this->deadband + ((2 * average + 8) >> 4);
+}
+
 long AnalogInput::getPosition(long rMin, long rMax) const {
-	// inversion is handled within the remap function
-	return remap(getPositionRaw(), getMin(), getMax(), rMin, rMax);
+	if (rMin != scaling.outMin || rMax != scaling.outMax) {
+		updateScaling(rMin, rMax);
+	}
+
+	// if the range can't be rescaled exactly with the fixed-point
+	// factor, fall back to division. Inversion is handled within
+	// the remap function.
+	if (!scaling.valid) {
+		return remap(getPositionRaw(), getMin(), getMax(), rMin, rMax);
+	}
+
+	// this follows the same steps as remap(), but replaces
+	// the division in map() with the precomputed factor
+	long value = getPositionRaw();
+	long inMin = getMin();
+	long inMax = getMax();
+
+	if (inMin > inMax) {
+		inMin = getMax();
+		inMax = getMin();
+		value = invertAxis(value, inMin, inMax);
+	}
+
+	if (value <= inMin) return rMin;
+	if (value >= inMax) return rMax;
+
+	const uint32_t offset = ((uint32_t)(value - inMin) * scaling.factor) >> scaling.shift;
+	return (rMax >= rMin) ? rMin + (long) offset : rMin - (long) offset;
+}
+
+void AnalogInput::updateScaling(long rMin, long rMax) const {
+	scaling.outMin = rMin;
+	scaling.outMax = rMax;
+	scaling.factor = 0;
+	scaling.shift = 0;
+	scaling.valid = false;
+
+	const long inRange = (getMax() >= getMin()) ? (long) getMax() - getMin() : (long) getMin() - getMax();
+	const long outRange = (rMax >= rMin) ? rMax - rMin : rMin - rMax;
+
+	// with 0 or 1 steps of input range, every value is at the range
+	// limits and the factor isn't needed (avoiding a divide by zero)
+	if (inRange < 2) {
+		scaling.valid = true;
+		return;
+	}
+
+	// the offset into the input range is always between 1 and 'inRange - 1'
+	// when scaled, as the limits are handled separately. For the fixed-point
+	// result to truncate identically to division, the error of the factor
+	// over that offset must be less than one part in 'inRange', which needs
+	// the factor to have enough fractional bits that 2^shift > in * (in - 1)
+	const uint32_t precision = (uint32_t) inRange * (uint32_t) (inRange - 1);
+	uint8_t shift = 1;
+	while (shift < 31 && ((uint32_t) 1 << shift) <= precision) {
+		shift++;
+	}
+
+	// the output range must fit above the fractional bits, so that
+	// neither the factor nor the multiplied offset overflow 32 bits
+	if (shift >= 31 || (uint32_t) outRange >= ((uint32_t) 1 << (32 - shift))) return;
+
+	// round the factor *up*, so that the fixed-point result never
+	// lands under an integer that division would reach exactly
+	scaling.factor = (((uint32_t) outRange << shift) / (uint32_t) inRange) + 1;
+	scaling.shift = shift;
+	scaling.valid = true;
 }
 
-int AnalogInput::getPositionRaw() const {
+AnalogValue AnalogInput::getPositionRaw() const {
 	return this->position;
 }
 
@@ -410,8 +1495,10 @@ bool AnalogInput::isInverted() const {
 	return (this->cal.min > this->cal.max);  // inverted if min is greater than max
 }
 
-void AnalogInput::setPosition(int newPos) {
+void AnalogInput::setPosition(AnalogValue newPos) {
 	this->position = newPos;
+	this->reported = newPos;
+	resetFilter(newPos);  // settle the filter so it picks up from here
 }
 
 void AnalogInput::setInverted(bool invert) {
@@ -424,6 +1511,155 @@ void AnalogInput::setInverted(bool invert) {
 
 void AnalogInput::setCalibration(AnalogInput::Calibration newCal) {
 	this->cal = newCal;
+	updateScaling(scaling.outMin, scaling.outMax);  // recompute for the new input range
+}
+
+/**
+* Rescales an ADC value from one oversampled resolution to another
+*
+* @param value the value to rescale
+* @param from  the number of extra bits of resolution the value has
+* @param to    the number of extra bits of resolution to rescale to
+* @returns the rescaled value
+*/
+static AnalogValue rescaleResolution(AnalogValue value, uint8_t from, uint8_t to) {
+	if (to > from) return value << (to - from);
+	return value >> (from - to);
+}
+
+void AnalogInput::setOversampling(uint8_t bits) {
+	if (bits > MaxOversampling) bits = MaxOversampling;
+	if (bits == this->oversampling) return;
+
+	// rescale the calibration and buffered position so that
+	// they're in the same range as the new readings
+	const Calibration newCal = {
+		rescaleResolution(this->cal.min, this->oversampling, bits),
+		rescaleResolution(this->cal.max, this->oversampling, bits),
+	};
+	const AnalogValue newPos = rescaleResolution(this->position, this->oversampling, bits);
+
+	this->oversampling = bits;
+	setCalibration(newCal);
+	setPosition(newPos);
+}
+
+void AnalogInput::setFilter(FilterType type, uint8_t strength, uint8_t speed) {
+	const uint8_t DefaultEMA     = 2;   // 1/4 of each new reading
+	const uint8_t DefaultWindow  = 3;   // median of 3
+	const uint8_t DefaultOneEuro = 4;   // 1/16 of each new reading while at rest
+	const uint8_t DefaultSpeed   = 16;
+	const uint8_t MaxStrength    = 7;   // 1/128 of each new reading
+
+	switch (type) {
+	case(FilterEMA):
+	case(FilterOneEuro):
+		if (strength == 0) strength = (type == FilterEMA) ? DefaultEMA : DefaultOneEuro;
+		if (strength > MaxStrength) strength = MaxStrength;
+		break;
+	case(FilterMedian):
+		if (strength == 0) strength = DefaultWindow;
+		if (strength > 3) strength = Filter::MaxWindow;  // only 3 or 5
+		else strength = 3;
+		break;
+	default:
+		type = FilterNone;
+		strength = 0;
+		break;
+	}
+
+	this->filter.type = type;
+	this->filter.strength = strength;
+	this->filter.speed = (speed == 0) ? DefaultSpeed : speed;
+	this->filter.primed = false;  // reset with the next reading
+}
+
+AnalogValue AnalogInput::applyFilter(AnalogValue value) {
+	if (this->filter.type == FilterNone) return value;
+
+	// if there's no history, start the filter from this reading
+	if (!this->filter.primed) {
+		resetFilter(value);
+		return value;
+	}
+
+	switch (this->filter.type) {
+	case(FilterEMA): {
+		// the accumulator holds the average scaled by 2^strength. Each
+		// reading replaces 1/2^strength of it, using the rounded average
+		// so that the output settles exactly on a constant input
+		long& acc = this->filter.accumulator;
+		const uint8_t shift = this->filter.strength;
+		const long half = 1L << (shift - 1);
+
+		acc += value - ((acc + half) >> shift);
+		return (acc + half) >> shift;
+	}
+	case(FilterMedian): {
+		// store the reading in the window, overwriting the oldest
+		const uint8_t size = this->filter.strength;
+		uint8_t& index = this->filter.median.index;
+
+		this->filter.median.readings[index] = value;
+		if (++index >= size) index = 0;
+
+		// insertion sort a copy of the window and take the middle
+		AnalogValue sorted[Filter::MaxWindow];
+		for (uint8_t i = 0; i < size; ++i) {
+			const AnalogValue reading = this->filter.median.readings[i];
+			uint8_t j = i;
+			for (; j > 0 && sorted[j - 1] > reading; --j) {
+				sorted[j] = sorted[j - 1];
+			}
+			sorted[j] = reading;
+		}
+		return sorted[size / 2];
+	}
+	case(FilterOneEuro): {
+		// values are stored in 1/16ths of a count, so that the
+		// filter can settle between whole numbers
+		const long x = (long) value << 4;
+		const long delta = x - this->filter.euro.value;
+		const long magnitude = (delta < 0) ? -delta : delta;
+
+		// smooth the rate of change (1/4 per reading), so that
+		// noise alone doesn't open up the filter
+		long& slope = this->filter.euro.slope;
+		slope += (magnitude - slope) >> 2;
+
+		// the smoothing factor (out of 256) starts from the 'at rest'
+		// strength and increases with the rate of change, up to
+		// passing the reading through unfiltered
+		long alpha = (256 >> this->filter.strength) + ((slope * this->filter.speed) >> 4);
+		if (alpha > 256) alpha = 256;
+
+		this->filter.euro.value += (delta * alpha + 128) >> 8;
+		return (this->filter.euro.value + 8) >> 4;
+	}
+	default:
+		return value;
+	}
+}
+
+void AnalogInput::resetFilter(AnalogValue value) {
+	switch (this->filter.type) {
+	case(FilterEMA):
+		this->filter.accumulator = (long) value << this->filter.strength;
+		break;
+	case(FilterMedian):
+		for (uint8_t i = 0; i < Filter::MaxWindow; ++i) {
+			this->filter.median.readings[i] = value;
+		}
+		this->filter.median.index = 0;
+		break;
+	case(FilterOneEuro):
+		this->filter.euro.value = (long) value << 4;
+		this->filter.euro.slope = 0;
+		break;
+	default:
+		break;
+	}
+	this->filter.primed = true;
 }
 
 //#########################################################
@@ -431,16 +1667,34 @@ void AnalogInput::setCalibration(AnalogInput::Calibration newCal) {
 //#########################################################
 
 bool Peripheral::update() {
+	return this->updateFrame(nullptr);
+}
+
+bool Peripheral::update(const Frame& f) {
+	return this->updateFrame(&f);
+}
+
+bool Peripheral::updateFrame(const Frame* f) {
+	const bool connected = this->pollConnection(f);
+
+	// call the derived class update function, with
+	// the frame available for timestamps
+	this->setFrame(f);
+	const bool changed = this->updateState(connected);
+	this->setFrame(nullptr);
+
+	return changed;
+}
+
+bool Peripheral::pollConnection(const Frame* f) {
 	// if the detector exists, poll for state
 	if (this->detector) {
-		this->detector->poll();
+		if (f) this->detector->poll(*f);
+		else this->detector->poll();
 	}
 
 	// get the connected state from the detector
-	const bool connected = this->isConnected();
-
-	// call the derived class update function
-	return this->updateState(connected);
+	return this->isConnected();
 }
 
 bool Peripheral::isConnected() const {
@@ -464,6 +1718,115 @@ void Peripheral::setStablePeriod(unsigned long t) {
 	}
 }
 
+bool Peripheral::setDetectInterrupt(bool enabled) {
+	// if detector exists, set the detection mode
+	if (this->detector) {
+		return this->detector->setInterruptMode(enabled);
+	}
+	return false;
+}
+
+//#########################################################
+//                      Scheduler                         #
+//#########################################################
+
+Scheduler::Scheduler()
+	: numTasks(0)
+{}
+
+bool Scheduler::add(Peripheral& peripheral, unsigned long rate) {
+	const unsigned long interval = (rate == 0) ? 0 : 1000000UL / rate;
+
+	// if the peripheral is already scheduled, take it out so
+	// it can be re-sorted with its new rate
+	Task task = {};
+	uint8_t index = 0;
+	while (index < numTasks && tasks[index].peripheral != &peripheral) index++;
+
+	if (index < numTasks) {
+		task = tasks[index];
+		for (uint8_t i = index; i + 1 < numTasks; ++i) tasks[i] = tasks[i + 1];
+		numTasks--;
+	}
+	else if (numTasks >= MaxTasks) {
+		return false;  // full
+	}
+
+	task.peripheral = &peripheral;
+	task.interval = interval;
+
+	// insert sorted by interval, slowest first, so that the fastest
+	// peripherals are updated last and are the freshest
+	uint8_t pos = numTasks;
+	for (; pos > 0 && tasks[pos - 1].interval < interval; --pos) {
+		tasks[pos] = tasks[pos - 1];
+	}
+	tasks[pos] = task;
+	numTasks++;
+
+	return true;
+}
+
+bool Scheduler::update() {
+	this->frame.tick();
+	return this->update(this->frame);
+}
+
+bool Scheduler::update(const Frame& f) {
+	bool changed = false;
+
+	for (uint8_t i = 0; i < numTasks; ++i) {
+		Task& task = tasks[i];
+
+		// read the clock as each task starts rather than using the frame
+		// time, so the time spent on the tasks before this one (or by the
+		// sketch since the frame started) counts towards how late it is
+		const unsigned long now = micros();
+
+		// the first update is due immediately, as is every
+		// update for peripherals without a rate
+		if (!task.started || task.interval == 0) {
+			task.deadline = now;
+			task.started = true;
+		}
+
+		const unsigned long late = now - task.deadline;
+		if ((long) late < 0) continue;  // not due yet
+
+		changed |= task.peripheral->update(f);
+
+		task.stats.runs++;
+		task.stats.lastJitter = late;
+		if (late > task.stats.maxJitter) task.stats.maxJitter = late;
+
+		// if we're late by a whole interval or more, those updates were
+		// missed. Restart the schedule from now instead of bunching up
+		// updates to catch up.
+		if (task.interval != 0 && late >= task.interval) {
+			task.stats.missed += late / task.interval;
+			task.deadline = now + task.interval;
+		}
+		else {
+			task.deadline += task.interval;
+		}
+	}
+
+	return changed;
+}
+
+Scheduler::Stats Scheduler::getStats(const Peripheral& peripheral) const {
+	for (uint8_t i = 0; i < numTasks; ++i) {
+		if (tasks[i].peripheral == &peripheral) return tasks[i].stats;
+	}
+	return {};
+}
+
+void Scheduler::resetStats() {
+	for (uint8_t i = 0; i < numTasks; ++i) {
+		tasks[i].stats = {};
+	}
+}
+
 //#########################################################
 //                       Pedals                           #
 //#########################################################
@@ -492,8 +1855,8 @@ bool Pedals::updateState(bool connected) {
 	// otherwise, zero all pedals
 	else {
 		for (int i = 0; i < getNumPedals(); ++i) {
-			const int min = pedalData[i].getMin();
-			const int prev = pedalData[i].getPositionRaw();
+			const AnalogValue min = pedalData[i].getMin();
+			const AnalogValue prev = pedalData[i].getPositionRaw();
 			if (min != prev) {
 				pedalData[i].setPosition(min);
 				changed = true;
@@ -509,7 +1872,7 @@ long Pedals::getPosition(PedalID pedal, long rMin, long rMax) const {
 	return pedalData[pedal].getPosition(rMin, rMax);
 }
 
-int Pedals::getPositionRaw(PedalID pedal) const {
+AnalogValue Pedals::getPositionRaw(PedalID pedal) const {
 	if (!hasPedal(pedal)) return AnalogInput::Min;  // not a pedal
 	return pedalData[pedal].getPositionRaw();
 }
@@ -524,6 +1887,26 @@ void Pedals::setCalibration(PedalID pedal, AnalogInput::Calibration cal) {
 	pedalData[pedal].setPosition(pedalData[pedal].getMin());  // reset to min position
 }
 
+void Pedals::setFilter(PedalID pedal, AnalogInput::FilterType type, uint8_t strength, uint8_t speed) {
+	if (!hasPedal(pedal)) return;
+	pedalData[pedal].setFilter(type, strength, speed);
+}
+
+void Pedals::setOversampling(PedalID pedal, uint8_t bits) {
+	if (!hasPedal(pedal)) return;
+	pedalData[pedal].setOversampling(bits);
+}
+
+void Pedals::setDeadband(PedalID pedal, uint8_t counts, bool adaptive) {
+	if (!hasPedal(pedal)) return;
+	pedalData[pedal].setDeadband(counts, adaptive);
+}
+
+unsigned long Pedals::getSuppressedCount(PedalID pedal) const {
+	if (!hasPedal(pedal)) return 0;
+	return pedalData[pedal].getSuppressedCount();
+}
+
 String Pedals::getPedalName(PedalID pedal) {
 	String name;
 
@@ -590,17 +1973,17 @@ void Pedals::serialCalibration(Stream& iface) {
 	iface.println(separator);
 	iface.println();
 
-	float DeadzoneMin = 0.01;  // by default, 1% (trying to keep things responsive)
-	float DeadzoneMax = 0.025;  // by default, 2.5%
+	Fraction DeadzoneMin = 0.01;  // by default, 1% (trying to keep things responsive)
+	Fraction DeadzoneMax = 0.025;  // by default, 2.5%
 
 	iface.println(F("These settings are optional. Send 'y' to customize. Send any other character to continue with the default values."));
 
 	iface.print(F("  * Pedal Travel Deadzone, Start: \t"));
-	iface.print(DeadzoneMin);
+	printFraction(iface, DeadzoneMin);
 	iface.println(F("  (Used to avoid the pedal always being slightly pressed)"));
 
 	iface.print(F("  * Pedal Travel Deadzone, End:   \t"));
-	iface.print(DeadzoneMax);
+	printFraction(iface, DeadzoneMax);
 	iface.println(F("  (Used to guarantee that the pedal can be fully pressed)"));
 
 	iface.println();
@@ -609,11 +1992,11 @@ void Pedals::serialCalibration(Stream& iface) {
 
 	if (iface.read() == 'y') {
 		iface.println(F("Set the pedal travel starting deadzone as a floating point percentage."));
-		readFloat(DeadzoneMin, iface);
+		readFraction(DeadzoneMin, iface);
 		iface.println();
 
 		iface.println(F("Set the pedal travel ending deadzone as a floating point percentage."));
-		readFloat(DeadzoneMax, iface);
+		readFraction(DeadzoneMax, iface);
 		iface.println();
 	}
 
@@ -624,9 +2007,9 @@ void Pedals::serialCalibration(Stream& iface) {
 		auto &cMin = pedalCal[i].min;
 		auto &cMax = pedalCal[i].max;
 
-		const int range = abs(cMax - cMin);
-		const int dzMin = DeadzoneMin * (float)range;
-		const int dzMax = DeadzoneMax * (float)range;
+		const AnalogValue range = abs(cMax - cMin);
+		const AnalogValue dzMin = scaleFraction(range, DeadzoneMin);
+		const AnalogValue dzMax = scaleFraction(range, DeadzoneMax);
 
 		// non-inverted
 		if (cMax >= cMin) {
@@ -708,7 +2091,7 @@ LogitechPedals::LogitechPedals(PinNum gasPin, PinNum brakePin, PinNum clutchPin,
 	// taken from calibrating my own pedals. the springs are pretty stiff so while
 	// this covers the whole travel range, users may want to back it down for casual
 	// use (esp. for the brake travel)
-	this->setCalibration({ 904, 48 }, { 944, 286 }, { 881, 59 });
+	this->setCalibration({ fromTenBit(904), fromTenBit(48) }, { fromTenBit(944), fromTenBit(286) }, { fromTenBit(881), fromTenBit(59) });
 }
 
 LogitechDrivingForceGT_Pedals::LogitechDrivingForceGT_Pedals(PinNum gasPin, PinNum brakePin, PinNum detectPin)
@@ -717,7 +2100,7 @@ LogitechDrivingForceGT_Pedals::LogitechDrivingForceGT_Pedals(PinNum gasPin, PinN
 	detectObj(detectPin, false)  // active high
 {
 	this->setDetectPtr(&this->detectObj);
-	this->setCalibration({ 646, 0 }, { 473, 1023 });  // taken from calibrating my own pedals
+	this->setCalibration({ fromTenBit(646), fromTenBit(0) }, { fromTenBit(473), AnalogInput::Max });  // taken from calibrating my own pedals
 }
 
 
@@ -727,9 +2110,12 @@ LogitechDrivingForceGT_Pedals::LogitechDrivingForceGT_Pedals(PinNum gasPin, PinN
 
 Shifter::Shifter(Gear min, Gear max)
 	:
-	MinGear(min), MaxGear(max)
+	MinGear(min), MaxGear(max),
+	eventHead(0), eventCount(0), eventsDropped(0),
+	neutralTime(0), shifting(false)
 {
 	this->currentGear = this->previousGear = 0;  // neutral
+	this->resetShiftStats();
 }
 
 void Shifter::setGear(Gear gear) {
@@ -740,6 +2126,69 @@ void Shifter::setGear(Gear gear) {
 
 	this->previousGear = this->currentGear;
 	this->currentGear = gear;
+
+	if (this->currentGear != this->previousGear) {
+		this->recordChange(this->previousGear, this->currentGear);
+	}
+}
+
+void Shifter::recordChange(Gear from, Gear to) {
+	// use the frame time if we have one, so every
+	// change in the same update has the same time
+	const Frame* frame = this->getFrame();
+	const unsigned long now = frame ? frame->getMillis() : millis();
+
+	// if the queue is full, drop the oldest change to make room
+	if (this->eventCount == MaxEvents) {
+		this->eventHead = (this->eventHead + 1) % MaxEvents;
+		this->eventCount--;
+		this->eventsDropped++;
+	}
+
+	const uint8_t tail = (this->eventHead + this->eventCount) % MaxEvents;
+	this->events[tail] = { from, to, now };
+	this->eventCount++;
+
+	// leaving a gear for neutral starts a shift
+	if (to == 0) {
+		if (from != 0) {
+			this->neutralTime = now;
+			this->shifting = true;
+		}
+		return;
+	}
+
+	// engaging a gear finishes the shift, either from neutral or directly
+	// from another gear. Engaging from a start in neutral isn't a shift.
+	if (from == 0 && !this->shifting) return;
+
+	const unsigned long elapsed = (from == 0) ? (now - this->neutralTime) : 0;
+	this->shifting = false;
+
+	ShiftStats& stats = this->shiftStats;
+	stats.shifts++;
+	stats.last = elapsed;
+	stats.total += elapsed;
+	if (elapsed < stats.fastest) stats.fastest = elapsed;
+	if (elapsed > stats.slowest) stats.slowest = elapsed;
+}
+
+bool Shifter::getEvent(GearEvent& event) {
+	if (this->eventCount == 0) return false;
+
+	event = this->events[this->eventHead];
+	this->eventHead = (this->eventHead + 1) % MaxEvents;
+	this->eventCount--;
+	return true;
+}
+
+void Shifter::clearEvents() {
+	this->eventHead = 0;
+	this->eventCount = 0;
+}
+
+void Shifter::resetShiftStats() {
+	this->shiftStats = { 0, 0, (unsigned long) -1, 0, 0 };  // fastest starts at the max
 }
 
 char Shifter::getGearChar(int gear) {
@@ -809,9 +2258,16 @@ String Shifter::getGearString() const {
 /* Static calibration constants
 * These values are arbitrary - just what worked well with my own shifter.
 */
-const float AnalogShifter::CalEngagementPoint = 0.70;
-const float AnalogShifter::CalReleasePoint = 0.50;
-const float AnalogShifter::CalEdgeOffset = 0.60;
+const Fraction AnalogShifter::CalEngagementPoint = 0.70;
+const Fraction AnalogShifter::CalReleasePoint = 0.50;
+const Fraction AnalogShifter::CalEdgeOffset = 0.60;
+
+const AnalogShifter::GateMap AnalogShifter::DefaultGateMap = {
+	3,
+	{ 1, 3, 5 },   // top
+	{ 2, 4, -1 },  // bottom
+	AnalogShifter::ReverseShared, 6,
+};
 
 AnalogShifter::AnalogShifter(
 	Gear gearMin, Gear gearMax,
@@ -819,12 +2275,28 @@ AnalogShifter::AnalogShifter(
 ) : 
 	Shifter(gearMin, gearMax),
 
+	calibration(),  // zeroed until calibrated, as for a global
+
 	/* Two axes, X and Y */
 	analogAxis{ AnalogInput(pinX), AnalogInput(pinY) },
 
 	pinReverse(sanitizePin(pinRev)),
-	reverseState(false)
-{}
+	fastReverse(pinReverse),
+	reverseState(false),
+
+	predictLookahead(0),
+	predictSpeed(0),
+	lastY(0),
+	predicted(false),
+	predictAge(0),
+	predictions(0),
+	rollbacks(0)
+{
+	// start with no columns, so the default map
+	// spaces its column edges across the axis
+	this->gate.columns = 0;
+	this->setGateMap(DefaultGateMap);
+}
 
 void AnalogShifter::begin() {
 	if (this->pinReverse != UnusedPin) {
@@ -844,8 +2316,14 @@ bool AnalogShifter::updateState(bool connected) {
 		// set reverse state to unpressed
 		this->reverseState = false;
 
-		// set gear to neutral
+		// reset the prediction, starting from neutral
+		this->lastY = analogAxis[Axis::Y].getPosition();
+		this->predicted = false;
+
+		// set gear to neutral. This isn't a shift, so don't
+		// time the next gear engaged from here.
 		this->setGear(0);
+		this->cancelShift();
 
 		// status changed if gear changed
 		return this->gearChanged();
@@ -854,81 +2332,272 @@ bool AnalogShifter::updateState(bool connected) {
 	// poll the analog axes for new data
 	analogAxis[Axis::X].read();
 	analogAxis[Axis::Y].read();
-	const int x = analogAxis[Axis::X].getPosition();
-	const int y = analogAxis[Axis::Y].getPosition();
+	const AnalogValue x = analogAxis[Axis::X].getPosition();
+	const AnalogValue y = analogAxis[Axis::Y].getPosition();
+
+	// estimate the Y velocity from the previous update
+	const AnalogValue velocity = y - this->lastY;
+	this->lastY = y;
 
 	// poll the reverse button and cache in the class
 	this->reverseState = this->readReverseButton();
 
-	// check previous gears for comparison
+	// check previous gears for comparison, using the row of the
+	// previous gear in the gate map
 	const Gear previousGear = this->getGear();
-	const bool prevOdd = ((previousGear != -1) && (previousGear & 1));  // were we previously in an odd gear
-	const bool prevEven = (!prevOdd && previousGear != 0);  // were we previously in an even gear
+	const uint8_t prevIndex = previousGear + 1;  // indexed from reverse
+	const uint8_t prevRow = (prevIndex < sizeof(gearRows)) ? gearRows[prevIndex] : 0;
+	const bool prevOdd = (prevRow & RowTop);  // were we previously in an odd (top) gear
+	const bool prevEven = (prevRow & RowBottom);  // were we previously in an even (bottom) gear
+
+	// look up which thresholds the Y position is past from the grid,
+	// only comparing if the cell straddles one of them
+	const uint8_t cellY = grid[y >> (AnalogInput::Resolution - GridBits)] & GridZoneMask;
+	const uint8_t zone = (cellY & GridZoneSplit) ? classifyZone(y) : cellY;
+
+	const uint8_t triggers = (PastOddTrigger | PastEvenTrigger);
 
 	Gear newGear = 0;
+	bool early = false;  // engaged by prediction, before reaching the trigger
+
+	// A predicted gear is confirmed once the stick reaches its trigger.
+	// After that it's a normal gear, so a bounce off the end of the gate
+	// can't roll it back.
+	if (this->predicted) {
+		if ((prevOdd && (zone & PastOddTrigger)) || (prevEven && (zone & PastEvenTrigger))) {
+			this->predicted = false;
+		}
+		else {
+			++this->predictAge;
+		}
+	}
+
+	// If the previous gear was predicted but the stick turned back, or
+	// didn't reach the trigger within the lookahead, the prediction was
+	// wrong. Back to neutral.
+	if (this->predicted && (
+		(prevOdd && -velocity >= predictSpeed) ||
+		(prevEven && velocity >= predictSpeed) ||
+		this->predictAge > this->predictLookahead))
+	{
+		newGear = 0;
+	}
 
 	// If we're below the 'release' thresholds, we must still be in the previous gear
-	if ((prevOdd && y > calibration.oddRelease) || (prevEven && y < calibration.evenRelease)) {
+	else if ((prevOdd && (zone & PastOddRelease)) || (prevEven && (zone & PastEvenRelease))) {
 		newGear = previousGear;
 	}
 
 	// If we're *not* below the release thresholds, we may be in a different gear
 	else {
+		// If the stick is about to reach a trigger, treat it as if it has
+		uint8_t engage = zone;
+		if (this->predictLookahead != 0 && !(zone & triggers)) {
+			engage |= predictZone(y, velocity, zone);
+			early = (engage & triggers);
+		}
+
 		// Check if we're in even or odd gears (Y axis)
-		if (y > calibration.oddTrigger) {
-			newGear = 1;  // we're in an odd gear
+		const Gear* row = nullptr;
+		if (engage & PastOddTrigger) {
+			row = gate.top;  // we're in an odd gear
 		}
-		else if (y < calibration.evenTrigger) {
-			newGear = 2;  // we're in an even gear
+		else if (engage & PastEvenTrigger) {
+			row = gate.bottom;  // we're in an even gear
 		}
 
-		if (newGear != 0) {
+		if (row != nullptr) {
 			// Now check *which* gear we're in, if we're in one (X axis)
-			     if (x > calibration.rightEdge) newGear += 4;  // 1-2 + 4 = 5-6
-			else if (x >= calibration.leftEdge) newGear += 2;  // 1-2 + 2 = 3-4
-			// (note the '>=', because it would normally be a '<' check for the lower range)
-			// else gear = 1-2 (as set above)
+			const uint8_t cellX = grid[x >> (AnalogInput::Resolution - GridBits)] >> GridColumnShift;
+			const uint8_t column = (cellX == GridColumnSplit) ? classifyColumn(x) : cellX;
+			newGear = row[column];
 
 			const bool reverse = getReverseButton();
 
-			// If the reverse button is pressed and we're in 5th gear
+			if (newGear == -1) {
+				switch (gate.reverseMode) {
+				case(ReverseSlot):
+					break;
+				// With a lockout, the reverse slot is neutral
+				// unless the reverse button is pressed
+				case(ReverseLockout):
+					if (!reverse) newGear = 0;
+					break;
+				// If the reverse button is pressed or we were previously
+				// in reverse *and* we are currently in the shared slot,
+				// then we should be in reverse. Otherwise we're in the
+				// forward gear that shares the slot.
+				case(ReverseShared):
+					if (!reverse && previousGear != -1) newGear = gate.sharedGear;
+					break;
+				}
+			}
+
+			// If the reverse button is pressed and we're in the other
+			// slot of the shared reverse column (5th gear by default),
 			// something is wrong. Revert that and go back to neutral.
-			if (reverse && newGear == 5) {
+			else if (reverse && column == reverseColumn && gate.reverseMode == ReverseShared) {
 				newGear = 0;
 			}
+		}
+	}
+
+	// track a predicted gear until it's either confirmed by the
+	// trigger (above) or leaves early, which counts as a rollback
+	if (this->predicted) {
+		if (newGear != previousGear) {
+			this->predicted = false;
+			++this->rollbacks;
+		}
+	}
+	else if (early && newGear != 0) {
+		this->predicted = true;
+		this->predictAge = 0;
+		++this->predictions;
+	}
+
+	// finally, store the newly calculated gear
+	this->setGear(newGear);
+
+	return this->gearChanged();
+}
+
+long AnalogShifter::getPosition(Axis ax, long min, long max) const {
+	if (ax != Axis::X && ax != Axis::Y) return min;  // not an axis
+	return analogAxis[ax].getPosition(min, max);
+}
+
+AnalogValue AnalogShifter::getPositionRaw(Axis ax) const {
+	if (ax != Axis::X && ax != Axis::Y) return AnalogInput::Min;  // not an axis
+	return analogAxis[ax].getPositionRaw();
+}
+
+bool AnalogShifter::readReverseButton() {
+	// if the reverse pin is not set, avoid reading the
+	// floating input and just return 'false'
+	if (pinReverse == UnusedPin) {
+		return false;
+	}
+	return fastReverse.read();
+}
+
+void AnalogShifter::setFilter(AnalogInput::FilterType type, uint8_t strength, uint8_t speed) {
+	analogAxis[Axis::X].setFilter(type, strength, speed);
+	analogAxis[Axis::Y].setFilter(type, strength, speed);
+}
+
+uint8_t AnalogShifter::classifyColumn(AnalogValue x) const {
+	// each edge is the lowest position of its column, so check
+	// from the right and take the first edge we're past
+	uint8_t column = gate.columns - 1;
+	while (column > 0 && x < calibration.edges[column - 1]) {
+		--column;
+	}
+	return column;
+}
+
+void AnalogShifter::setPrediction(uint8_t lookahead, AnalogValue minSpeed) {
+	// by default, require a few counts per update at 10-bit
+	// so that noise around the release point isn't predicted
+	if (minSpeed <= 0) minSpeed = (AnalogInput::Max / 256) + 1;
+
+	this->predictLookahead = lookahead;
+	this->predictSpeed = minSpeed;
+	this->predicted = false;
+}
+
+uint8_t AnalogShifter::predictZone(AnalogValue y, AnalogValue velocity, uint8_t zone) const {
+	// only predict once the stick is past the release point, moving
+	// toward the gate fast enough that it's committed to it
+	const long ahead = (long) y + (long) velocity * predictLookahead;
+
+	if (velocity >= predictSpeed && (zone & PastOddRelease)) {
+		if (ahead > calibration.oddTrigger) return PastOddTrigger;
+	}
+	else if (-velocity >= predictSpeed && (zone & PastEvenRelease)) {
+		if (ahead < calibration.evenTrigger) return PastEvenTrigger;
+	}
+	return 0;
+}
+
+uint8_t AnalogShifter::classifyZone(AnalogValue y) const {
+	uint8_t zone = 0;
+	if (y > calibration.oddRelease)  zone |= PastOddRelease;
+	if (y < calibration.evenRelease) zone |= PastEvenRelease;
+	if (y > calibration.oddTrigger)  zone |= PastOddTrigger;
+	if (y < calibration.evenTrigger) zone |= PastEvenTrigger;
+	return zone;
+}
+
+void AnalogShifter::buildGrid() {
+	const uint8_t shift = AnalogInput::Resolution - GridBits;
+
+	// every comparison is monotonic, so a cell has the same result
+	// throughout if (and only if) both of its ends do
+	for (uint8_t i = 0; i < GridSize; ++i) {
+		const AnalogValue lo = (AnalogValue) i << shift;
+		const AnalogValue hi = lo + ((AnalogValue) 1 << shift) - 1;
+
+		uint8_t column = classifyColumn(lo);
+		if (column != classifyColumn(hi)) column = GridColumnSplit;
+
+		uint8_t zone = classifyZone(lo);
+		if (zone != classifyZone(hi)) zone = GridZoneSplit;
+
+		grid[i] = (column << GridColumnShift) | zone;
+	}
+}
+
+bool AnalogShifter::setGateMap(const GateMap& map) {
+	if (map.columns < 2 || map.columns > MaxColumns) return false;
+
+	// check the map and find the row of each gear
+	uint8_t rows[sizeof(gearRows)] = { 0 };
+	uint8_t usedRows = 0;
+	uint8_t revColumn = MaxColumns;
+
+	for (uint8_t c = 0; c < map.columns; ++c) {
+		const Gear slots[2] = { map.top[c], map.bottom[c] };
+		const uint8_t slotRows[2] = { RowTop, RowBottom };
 
-			// If the reverse button is pressed or we were previously
-			// in reverse *and* we are currently in 6th gear, then we
-			// should be in reverse.
-			else if ((reverse || previousGear == -1) && newGear == 6) {
-				newGear = -1;
-			}
-		}
-	}
+		if (slots[0] == 0 && slots[1] == 0) return false;  // empty column
 
-	// finally, store the newly calculated gear
-	this->setGear(newGear);
+		for (uint8_t r = 0; r < 2; ++r) {
+			const Gear g = slots[r];
+			if (g == 0) continue;  // unused slot
+			if (g < -1 || g > MaxGateGears) return false;  // not a gear
+			if (rows[g + 1] != 0) return false;  // duplicate gear
 
-	return this->gearChanged();
-}
+			rows[g + 1] = slotRows[r];
+			usedRows |= slotRows[r];
+			if (g == -1) revColumn = c;
+		}
+	}
+	if (usedRows != (RowTop | RowBottom)) return false;
 
-long AnalogShifter::getPosition(Axis ax, long min, long max) const {
-	if (ax != Axis::X && ax != Axis::Y) return min;  // not an axis
-	return analogAxis[ax].getPosition(min, max);
-}
+	// a shared reverse slot needs a forward gear to share it with
+	if (map.reverseMode == ReverseShared) {
+		const Gear g = map.sharedGear;
+		if (revColumn == MaxColumns || g < 1 || g > MaxGateGears || rows[g + 1] != 0) return false;
+		rows[g + 1] = rows[0];
+	}
 
-int AnalogShifter::getPositionRaw(Axis ax) const {
-	if (ax != Axis::X && ax != Axis::Y) return AnalogInput::Min;  // not an axis
-	return analogAxis[ax].getPositionRaw();
-}
+	// if the number of columns changed, space the edges evenly
+	// across the axis until calibrated
+	if (map.columns != this->gate.columns) {
+		for (uint8_t i = 1; i < map.columns; ++i) {
+			calibration.edges[i - 1] = (long) AnalogInput::Max * i / map.columns;
+		}
+	}
 
-bool AnalogShifter::readReverseButton() {
-	// if the reverse pin is not set, avoid reading the
-	// floating input and just return 'false'
-	if (pinReverse == UnusedPin) {
-		return false;
+	this->gate = map;
+	this->reverseColumn = revColumn;
+	for (uint8_t i = 0; i < sizeof(gearRows); ++i) {
+		this->gearRows[i] = rows[i];
 	}
-	return digitalRead(pinReverse);
+
+	buildGrid();
+	return true;
 }
 
 bool AnalogShifter::getReverseButton() const {
@@ -940,56 +2609,36 @@ bool AnalogShifter::getReverseButton() const {
 void AnalogShifter::setCalibration(
 	GearPosition neutral,
 	GearPosition g1, GearPosition g2, GearPosition g3, GearPosition g4, GearPosition g5, GearPosition g6,
-	float engagePoint, float releasePoint, float edgeOffset) {
+	Fraction engagePoint, Fraction releasePoint, Fraction edgeOffset) {
 
 	// limit percentage thresholds
-	engagePoint = floatPercent(engagePoint);
-	releasePoint = floatPercent(releasePoint);
-	edgeOffset = floatPercent(edgeOffset);
-
-	const int xLeft = (g1.x + g2.x) / 2;  // find the minimum X position average
-	const int xRight = (g5.x + g6.x) / 2;  // find the maximum X position average
-
-	const int yOdd = (g1.y + g3.y + g5.y) / 3;  // find the maximum Y position average
-	const int yEven = (g2.y + g4.y + g6.y) / 3;  // find the minimum Y position average
+	engagePoint = clampFraction(engagePoint);
+	releasePoint = clampFraction(releasePoint);
+	edgeOffset = clampFraction(edgeOffset);
 
-	// set X/Y calibration and inversion
-	analogAxis[Axis::X].setCalibration({ xLeft, xRight });
-	analogAxis[Axis::Y].setCalibration({ yEven, yOdd });
-
-	// save neutral values (raw)
-	calibration.neutralX = neutral.x;
-	calibration.neutralY = neutral.y;
+	// sums are taken as 'long', so they can't overflow at higher ADC resolutions
+	const AnalogValue xLeft = ((long) g1.x + g2.x) / 2;  // find the minimum X position average
+	const AnalogValue xRight = ((long) g5.x + g6.x) / 2;  // find the maximum X position average
 
-	// get normalized and inverted neutral values
-	// this lets us take advantage of the AnalogInput normalization function
-	// that handles inverted axes and automatic range rescaling, so the rest of
-	// the calibration options can be in the normalized range
-	const Axis axes[2] = { Axis::X, Axis::Y };
-	int* const neutralAxis[2] = { &neutral.x, &neutral.y };
-	for (int i = 0; i < 2; i++) {
-		const int previous = analogAxis[axes[i]].getPositionRaw();  // save current value
-		analogAxis[axes[i]].setPosition(*neutralAxis[i]);           // set new value to neutral calibration
-		*neutralAxis[i] = analogAxis[axes[i]].getPosition();        // get normalized neutral value
-		analogAxis[axes[i]].setPosition(previous);                  // reset axis position to previous
-	}
+	const AnalogValue yOdd = ((long) g1.y + g3.y + g5.y) / 3;  // find the maximum Y position average
+	const AnalogValue yEven = ((long) g2.y + g4.y + g6.y) / 3;  // find the minimum Y position average
 
-	// calculate the distances between each neutral and the limits of each axis
-	const int yOddDiff = AnalogInput::Max - neutral.y;
-	const int yEvenDiff = neutral.y - AnalogInput::Min;
+	// these positions are for the default gate
+	this->setGateMap(DefaultGateMap);
 
-	const int leftDiff = neutral.x - AnalogInput::Min;
-	const int rightDiff = AnalogInput::Max - neutral.x;
+	// set the axis calibration and Y thresholds, and get the normalized neutral
+	neutral = this->calibrateAxes(neutral, xLeft, xRight, yEven, yOdd, engagePoint, releasePoint);
 
-	// calculate and save the trigger and release points for each level
-	calibration.oddTrigger = neutral.y + ((float)yOddDiff * engagePoint);
-	calibration.oddRelease = neutral.y + ((float)yOddDiff * releasePoint);
+	// calculate the distances between neutral and the limits of the X axis
+	const AnalogValue leftDiff = neutral.x - AnalogInput::Min;
+	const AnalogValue rightDiff = AnalogInput::Max - neutral.x;
 
-	calibration.evenTrigger = neutral.y - ((float)yEvenDiff * engagePoint);
-	calibration.evenRelease = neutral.y - ((float)yEvenDiff * releasePoint);
+	// calculate and save the edges of the side columns. The right edge
+	// is exclusive, so its column starts at the next position.
+	calibration.edges[0] = neutral.x - scaleFraction(leftDiff, edgeOffset);
+	calibration.edges[1] = (AnalogValue)(neutral.x + scaleFraction(rightDiff, edgeOffset)) + 1;
 
-	calibration.leftEdge = neutral.x - ((float)leftDiff * edgeOffset);
-	calibration.rightEdge = neutral.x + ((float)rightDiff * edgeOffset);
+	buildGrid();
 
 #if 0
 	Serial.print("Odd Trigger: ");
@@ -1001,9 +2650,9 @@ void AnalogShifter::setCalibration(
 	Serial.print("Even Release: ");
 	Serial.println(calibration.evenRelease);
 	Serial.print("Left Edge: ");
-	Serial.println(calibration.leftEdge);
+	Serial.println(calibration.edges[0]);
 	Serial.print("Right Edge: ");
-	Serial.println(calibration.rightEdge);
+	Serial.println(calibration.edges[1]);
 	Serial.println();
 
 	Serial.print("X Min: ");
@@ -1018,6 +2667,105 @@ void AnalogShifter::setCalibration(
 #endif
 }
 
+void AnalogShifter::setCalibration(
+	GearPosition neutral, const GearPosition* gears, GearPosition reverse,
+	Fraction engagePoint, Fraction releasePoint) {
+
+	// limit percentage thresholds
+	engagePoint = clampFraction(engagePoint);
+	releasePoint = clampFraction(releasePoint);
+
+	// average the positions of the gears in each column and row,
+	// as 'long' so the sums can't overflow at higher ADC resolutions
+	long columnSum[MaxColumns] = { 0 };
+	uint8_t columnCount[MaxColumns] = { 0 };
+	long rowSum[2] = { 0, 0 };  // top, bottom
+	uint8_t rowCount[2] = { 0, 0 };
+
+	for (uint8_t c = 0; c < gate.columns; ++c) {
+		const Gear slots[2] = { gate.top[c], gate.bottom[c] };
+
+		for (uint8_t r = 0; r < 2; ++r) {
+			Gear g = slots[r];
+			if (g == 0) continue;  // unused slot
+
+			// a shared reverse slot is recorded as its forward gear
+			if (g == -1 && gate.reverseMode == ReverseShared) g = gate.sharedGear;
+
+			const GearPosition& pos = (g == -1) ? reverse : gears[g - 1];
+			columnSum[c] += pos.x;
+			columnCount[c]++;
+			rowSum[r] += pos.y;
+			rowCount[r]++;
+		}
+	}
+
+	AnalogValue columnX[MaxColumns];
+	for (uint8_t c = 0; c < gate.columns; ++c) {
+		columnX[c] = columnSum[c] / columnCount[c];
+	}
+
+	const AnalogValue yTop = rowSum[0] / rowCount[0];
+	const AnalogValue yBottom = rowSum[1] / rowCount[1];
+
+	// set the axis calibration and Y thresholds, with the outer columns
+	// as the limits of the X axis
+	this->calibrateAxes(neutral, columnX[0], columnX[gate.columns - 1], yBottom, yTop, engagePoint, releasePoint);
+
+	// place each column edge halfway between the normalized positions
+	// of the columns on either side of it
+	AnalogValue previous = normalizePosition(Axis::X, columnX[0]);
+	for (uint8_t c = 1; c < gate.columns; ++c) {
+		const AnalogValue current = normalizePosition(Axis::X, columnX[c]);
+		calibration.edges[c - 1] = ((long) previous + current + 1) / 2;
+		previous = current;
+	}
+
+	buildGrid();
+}
+
+AnalogShifter::GearPosition AnalogShifter::calibrateAxes(
+	GearPosition neutral,
+	AnalogValue xMin, AnalogValue xMax, AnalogValue yMin, AnalogValue yMax,
+	Fraction engagePoint, Fraction releasePoint) {
+
+	// set X/Y calibration and inversion
+	analogAxis[Axis::X].setCalibration({ xMin, xMax });
+	analogAxis[Axis::Y].setCalibration({ yMin, yMax });
+
+	// save neutral values (raw)
+	calibration.neutralX = neutral.x;
+	calibration.neutralY = neutral.y;
+
+	// get normalized and inverted neutral values
+	// this lets us take advantage of the AnalogInput normalization function
+	// that handles inverted axes and automatic range rescaling, so the rest of
+	// the calibration options can be in the normalized range
+	neutral.x = normalizePosition(Axis::X, neutral.x);
+	neutral.y = normalizePosition(Axis::Y, neutral.y);
+
+	// calculate the distances between neutral and the limits of the Y axis
+	const AnalogValue yOddDiff = AnalogInput::Max - neutral.y;
+	const AnalogValue yEvenDiff = neutral.y - AnalogInput::Min;
+
+	// calculate and save the trigger and release points for each level
+	calibration.oddTrigger = neutral.y + scaleFraction(yOddDiff, engagePoint);
+	calibration.oddRelease = neutral.y + scaleFraction(yOddDiff, releasePoint);
+
+	calibration.evenTrigger = neutral.y - scaleFraction(yEvenDiff, engagePoint);
+	calibration.evenRelease = neutral.y - scaleFraction(yEvenDiff, releasePoint);
+
+	return neutral;
+}
+
+AnalogValue AnalogShifter::normalizePosition(Axis ax, AnalogValue raw) {
+	const AnalogValue previous = analogAxis[ax].getPositionRaw();  // save current value
+	analogAxis[ax].setPosition(raw);                               // set new value to normalize
+	const AnalogValue normalized = analogAxis[ax].getPosition();   // get normalized value
+	analogAxis[ax].setPosition(previous);                          // reset axis position to previous
+	return normalized;
+}
+
 void AnalogShifter::serialCalibration(Stream& iface) {
 	if (isConnected() == false) {
 		iface.print(F("Error! Cannot perform calibration, "));
@@ -1034,9 +2782,9 @@ void AnalogShifter::serialCalibration(Stream& iface) {
 	iface.println();
 
 	AnalogShifter::GearPosition gears[7];  // neutral, then 1-6
-	float engagementPoint = CalEngagementPoint;
-	float releasePoint = CalReleasePoint;
-	float edgeOffset = CalEdgeOffset;
+	Fraction engagementPoint = CalEngagementPoint;
+	Fraction releasePoint = CalReleasePoint;
+	Fraction edgeOffset = CalEdgeOffset;
 
 	for (int i = 0; i <= 6; i++) {
 		const String gearName = this->getGearString(i);
@@ -1069,13 +2817,16 @@ void AnalogShifter::serialCalibration(Stream& iface) {
 	iface.println(F("These settings are optional. Send 'y' to customize. Send any other character to continue with the default values."));
 
 	iface.print(F("  * Gear Engagement Point: \t"));
-	iface.println(engagementPoint);
+	printFraction(iface, engagementPoint);
+	iface.println();
 
 	iface.print(F("  * Gear Release Point:   \t"));
-	iface.println(releasePoint);
+	printFraction(iface, releasePoint);
+	iface.println();
 
 	iface.print(F("  * Horizontal Gate Offset:\t"));
-	iface.println(edgeOffset);
+	printFraction(iface, edgeOffset);
+	iface.println();
 
 	iface.println();
 
@@ -1083,15 +2834,15 @@ void AnalogShifter::serialCalibration(Stream& iface) {
 
 	if (iface.read() == 'y') {
 		iface.println(F("Set the engagement point as a floating point percentage. This is the percentage away from the neutral axis on Y to start engaging gears."));
-		readFloat(engagementPoint, iface);
+		readFraction(engagementPoint, iface);
 		iface.println();
 
 		iface.println(F("Set the release point as a floating point percentage. This is the percentage away from the neutral axis on Y to go back into neutral. It must be less than the engagement point."));
-		readFloat(releasePoint, iface);
+		readFraction(releasePoint, iface);
 		iface.println();
 
 		iface.println(F("Set the gate offset as a floating point percentage. This is the percentage away from the neutral axis on X to select the side gears."));
-		readFloat(edgeOffset, iface);
+		readFraction(edgeOffset, iface);
 		iface.println();
 	}
 
@@ -1115,11 +2866,11 @@ void AnalogShifter::serialCalibration(Stream& iface) {
 		iface.print('}');
 		iface.print(", ");
 	}
-	iface.print(engagementPoint);
+	printFraction(iface, engagementPoint);
 	iface.print(", ");
-	iface.print(releasePoint);
+	printFraction(iface, releasePoint);
 	iface.print(", ");
-	iface.print(edgeOffset);
+	printFraction(iface, edgeOffset);
 	iface.print(");");
 	iface.println();
 
@@ -1141,7 +2892,14 @@ LogitechShifter::LogitechShifter(PinNum pinX, PinNum pinY, PinNum pinRev, PinNum
 	detectObj(detectPin, false)  // active high
 {
 	this->setDetectPtr(&this->detectObj);
-	this->setCalibration({ 490, 440 }, { 253, 799 }, { 262, 86 }, { 460, 826 }, { 470, 76 }, { 664, 841 }, { 677, 77 });
+	this->setCalibration(
+		{ fromTenBit(490), fromTenBit(440) },
+		{ fromTenBit(253), fromTenBit(799) },
+		{ fromTenBit(262), fromTenBit(86) },
+		{ fromTenBit(460), fromTenBit(826) },
+		{ fromTenBit(470), fromTenBit(76) },
+		{ fromTenBit(664), fromTenBit(841) },
+		{ fromTenBit(677), fromTenBit(77) });
 }
 
 
@@ -1153,111 +2911,162 @@ LogitechShifterG27::LogitechShifterG27(
 ) :
 	LogitechShifter(pinX, pinY, UnusedPin, pinDetect),
 
-	pinLatch(sanitizePin(pinLatch)), pinClock(sanitizePin(pinClock)), pinData(sanitizePin(pinData)),
-	pinLed(sanitizePin(pinLed))
+	shiftRegisters(pinLatch, pinClock, pinData),
+	pinLed(sanitizePin(pinLed)), fastLed(this->pinLed)
 {
-	this->pinModesSet = false;
 	this->setPowerLED(1);  // power LED on by default
+	this->deviceType = DEVICE_UNKNOWN;  // detected once connected
 	this->buttonStates = this->previousButtons = 0x0000;  // zero all button data
+	this->buttonEvents = nullptr;  // event queue disabled by default
+	this->buttonEventSize = 0;
+	this->buttonEventHead = this->buttonEventTail = 0;  // empty the event queue
+	this->buttonEventsDropped = 0;
+	this->setDebounce(0);  // no debouncing by default
+
+	// read all buttons by default, and always read the
+	// reverse button as it's needed for the H-pattern shifter
+	this->requiredButtons = 0x0000;
+	this->setUsedButtons(0xFFFF);
+	this->addRequiredButtons(1 << (uint8_t) Button::BUTTON_REVERSE);
 
 	// using the calibration values from my own G27 shifter
-	this->setCalibration({ 453, 470 }, { 247, 828 }, { 258, 6 }, { 449, 878 }, { 472, 5 }, { 645, 880 }, { 651, 21 });
+	this->setCalibration(
+		{ fromTenBit(453), fromTenBit(470) },
+		{ fromTenBit(247), fromTenBit(828) },
+		{ fromTenBit(258), fromTenBit(6) },
+		{ fromTenBit(449), fromTenBit(878) },
+		{ fromTenBit(472), fromTenBit(5) },
+		{ fromTenBit(645), fromTenBit(880) },
+		{ fromTenBit(651), fromTenBit(21) });
 }
 
 void LogitechShifterG27::cacheButtons(uint16_t newStates) {
 	this->previousButtons = this->buttonStates;  // save current to previous
 	this->buttonStates = newStates;  // replace current with new value
+
+	// queue an event for every button that changed
+	uint16_t edges = this->buttonStates ^ this->previousButtons;
+	if (edges == 0 || this->buttonEvents == nullptr) return;
+
+	const Frame* frame = this->getFrame();
+	const unsigned long now = frame ? frame->getMillis() : millis();
+
+	for (uint8_t i = 0; edges != 0; ++i, edges >>= 1) {
+		if (!(edges & 1)) continue;
+
+		// if the queue is full, drop the new event. The head
+		// belongs to the reader, so we can't drop the oldest.
+		const uint8_t tail = this->buttonEventTail;
+		if ((uint8_t)(tail - this->buttonEventHead) >= this->buttonEventSize) {
+			this->buttonEventsDropped++;
+			continue;
+		}
+
+		const Button button = (Button) i;
+		this->buttonEvents[tail & (this->buttonEventSize - 1)] = { button, extractButton(button, newStates), now };
+		this->buttonEventTail = tail + 1;
+	}
 }
 
-void LogitechShifterG27::setPinModes(bool enabled) {
-	// check if pins are valid. if one or more pins is unused,
-	// this isn't going to work and we shouldn't bother setting
-	// any of the pin states
-	if (
-		this->pinData  == UnusedPin ||
-		this->pinLatch == UnusedPin ||
-		this->pinClock == UnusedPin)
-	{
-		return;
+void LogitechShifterG27::setButtonEventBuffer(ButtonEvent* buffer, uint8_t size) {
+	if (size > MaxButtonEvents) size = MaxButtonEvents;
+
+	// round down to a power of two, so the wrapping
+	// indices always land on the same slot
+	uint8_t pow2 = 0;
+	if (buffer != nullptr && size != 0) {
+		pow2 = 1;
+		while (pow2 * 2 <= size) pow2 *= 2;
 	}
 
-	// set up data pin to read from regardless
-	pinMode(this->pinData, INPUT);
+	InterruptLock lock;
+	this->buttonEvents = (pow2 != 0) ? buffer : nullptr;
+	this->buttonEventSize = pow2;
+	this->buttonEventHead = this->buttonEventTail = 0;
+}
 
-	// enabled = drive the output pins
-	if (enabled) {
-		// note: writing the output before setting the
-		// pin mode so that we don't accidentally drive
-		// the wrong direction momentarily
+bool LogitechShifterG27::getButtonEvent(ButtonEvent& event) {
+	bool available = false;
 
-		// set latch pin as output, HIGH on idle
-		digitalWrite(this->pinLatch, HIGH);
-		pinMode(this->pinLatch, OUTPUT);
+	// the buttons may be updated by an interrupt,
+	// so take the event in one go
+	InterruptLock lock;
+	const uint8_t head = this->buttonEventHead;
+	if (head != this->buttonEventTail) {
+		event = this->buttonEvents[head & (this->buttonEventSize - 1)];
+		this->buttonEventHead = head + 1;
+		available = true;
+	}
 
-		// set clock pin as output, LOW on idle
-		digitalWrite(this->pinClock, LOW);
-		pinMode(this->pinClock, OUTPUT);
+	return available;
+}
+
+uint8_t LogitechShifterG27::getButtonEventCount() const {
+	return this->buttonEventTail - this->buttonEventHead;
+}
+
+unsigned long LogitechShifterG27::getDroppedButtonEvents() const {
+	InterruptLock lock;
+	return this->buttonEventsDropped;
+}
 
-		// if we have an LED pin, set it to output and write the
-		// commanded state (inverted, as the LED is active-low)
+void LogitechShifterG27::clearButtonEvents() {
+	InterruptLock lock;
+	this->buttonEventHead = this->buttonEventTail;
+}
+
+void LogitechShifterG27::setPinModes(bool enabled) {
+	// check if the shift register pins are valid. if not,
+	// this isn't going to work and we shouldn't bother setting
+	// any of the pin states
+	if (!this->shiftRegisters.isValid()) return;
+
+	this->shiftRegisters.setPinModes(enabled);
+
+	// if we have an LED pin, set it to output and write the
+	// commanded state (inverted, as the LED is active-low)
+	if (enabled) {
 		if (this->pinLed != UnusedPin) {
 			digitalWrite(this->pinLed, !(this->ledState));
 			pinMode(this->pinLed, OUTPUT);
 		}
 	}
 
-	// disabled = leave output pins as high-z
+	// if we have an LED pin, set it to input, LOW on idle
 	else {
-		// note: setting the mode before writing the
-		// output for the same reason; changing in
-		// high-z mode is safer
-
-		// set latch pin as high impedance, with pull-up
-		pinMode(this->pinLatch, INPUT);
-		digitalWrite(this->pinLatch, HIGH);
-
-		// set clock pin as high impedance, no pull-up
-		pinMode(this->pinClock, INPUT);
-		digitalWrite(this->pinClock, LOW);
-
-		// if we have an LED pin, set it to input, LOW on idle
 		if (this->pinLed != UnusedPin) {
 			pinMode(this->pinLed, INPUT);
 			digitalWrite(this->pinLed, LOW);
 		}
 	}
-
-	this->pinModesSet = enabled;
 }
 
 void LogitechShifterG27::setPowerLED(bool state) {
 	this->ledState = state;
 }
 
+bool LogitechShifterG27::setHardwareSPI(bool enabled) {
+	return this->shiftRegisters.setHardwareSPI(enabled);
+}
+
 uint16_t LogitechShifterG27::readShiftRegisters() {
-	// if the pin outputs are not set, quit (none pressed)
-	if (!this->pinModesSet) return 0x0000;
+	// the "Driving Force" shifter has no shift registers, just the reverse
+	// button on the data pin. Once we know that's what's connected, there's
+	// no need to latch or clock anything.
+	if (this->deviceType == DEVICE_DRIVING_FORCE) {
+		return this->shiftRegisters.readData() ? (1 << (uint8_t) Button::BUTTON_REVERSE) : 0x0000;
+	}
 
-	uint16_t data = 0x0000;
+	// if the LED shares the SPI output pin, the output is driven by
+	// the SPI peripheral. Send all ones or all zeroes so that the
+	// LED stays in its commanded state (active low).
+	const uint8_t fill = (this->ledState) ? 0x00 : 0xFF;
 
-	// pulse shift register latch from high to low to high, 12 us
-	// (this timing is *completely* arbitrary, but it's nice to have
-	//  *some* delay so that much faster MCUs don't blow through it)
-	digitalWrite(this->pinLatch, LOW);
-	delayMicroseconds(12);
-	digitalWrite(this->pinLatch, HIGH);
-	delayMicroseconds(12);
+	// if the pin outputs are not set, quit (none pressed)
+	uint8_t bytes[2];
+	if (!this->shiftRegisters.readBits(bytes, this->readLength, fill)) return 0x0000;
 
-	// clock is pulsed from LOW to HIGH on every bit,
-	// and then left to idle low
-	for (int i = 0; i < 16; ++i) {
-		digitalWrite(this->pinClock, LOW);
-		const bool state = digitalRead(this->pinData);
-		if (state) data |= 1 << (15 - i);  // store data in word, MSB-first
-		digitalWrite(this->pinClock, HIGH);
-		delayMicroseconds(6);
-	}
-	digitalWrite(this->pinClock, LOW);
+	const uint16_t data = ((uint16_t) bytes[0] << 8) | bytes[1];  // MSB-first
 
 	// edge case: two of the bits (0x8000 and 0x2000) are connected only to
 	// pull-down resistors, and should theoretically never be high. If they,
@@ -1270,8 +3079,22 @@ uint16_t LogitechShifterG27::readShiftRegisters() {
 	// QED: we are connected to a "Driving Force" shifter, and not a G27.
 	// That's okay! If we set the state of the 'reverse' button and clear
 	// all others, we can still behave like a G27.
-	if (data == 0xFFFF) {
-		data = (1 << (uint8_t) Button::BUTTON_REVERSE);
+	//
+	// The reverse button is always read, so a partial read still includes
+	// 0x8000, which is enough to tell the two apart.
+	//
+	// Both shifters read all zeroes with nothing pressed, so the type
+	// stays unknown until we see either all ones or any other data. Once
+	// it's known, it's kept until the shifter is reconnected.
+	if (this->deviceType == DEVICE_UNKNOWN) {
+		const uint16_t readMask = (uint16_t) (0xFFFF << (16 - this->readLength));
+		if (data == readMask) {
+			this->deviceType = DEVICE_DRIVING_FORCE;
+			return (1 << (uint8_t) Button::BUTTON_REVERSE);
+		}
+		else if (data != 0x0000) {
+			this->deviceType = DEVICE_G27;
+		}
 	}
 
 	return data;
@@ -1294,15 +3117,20 @@ bool LogitechShifterG27::updateState(bool connected) {
 	// if we're connected, set the pin modes, read the
 	// shift registers, and cache the data
 	if (connected) {
-		if (!this->pinModesSet) {
+		// newly connected, detect the shifter type again
+		if (!this->shiftRegisters.isEnabled()) {
 			this->setPinModes(1);
+			this->deviceType = DEVICE_UNKNOWN;
 		}
 
 		if (this->pinLed != UnusedPin) {
-			digitalWrite(this->pinLed, !(this->ledState));  // active low
+			this->fastLed.write(!(this->ledState));  // active low
 		}
 
-		const uint16_t data = this->readShiftRegisters();
+		uint16_t data = SIM_RACING_TRACE_READ(ShiftRegisters, this->shiftRegisters.getDataPin(), this->readShiftRegisters());
+		if (this->debouncer.enabled()) {
+			data = this->debouncer.update(data, this->buttonStates);
+		}
 		this->cacheButtons(data);
 		changed |= this->buttonsChanged();
 	}
@@ -1310,12 +3138,16 @@ bool LogitechShifterG27::updateState(bool connected) {
 	// if we're *not* connected, reset the pin modes and
 	// set no buttons pressed
 	else {
-		if (this->pinModesSet) {
+		if (this->shiftRegisters.isEnabled()) {
 			this->setPinModes(0);
 		}
+		this->deviceType = DEVICE_UNKNOWN;
 
 		this->cacheButtons(0x0000);
 		changed |= this->buttonsChanged();
+
+		// the buttons are released immediately, so reset their counters
+		this->debouncer.reset();
 	}
 
 	// we also need to update the data for the analog shifter
@@ -1324,6 +3156,35 @@ bool LogitechShifterG27::updateState(bool connected) {
 	return changed;
 }
 
+void LogitechShifterG27::setDebounce(uint8_t samples) {
+	this->debouncer.setLimit(0xFFFF, samples);
+}
+
+void LogitechShifterG27::setDebounce(Button button, uint8_t samples) {
+	this->debouncer.setLimit(1 << (uint8_t) button, samples);
+}
+
+uint8_t LogitechShifterG27::getDebounce(Button button) const {
+	return this->debouncer.getLimit((uint8_t) button);
+}
+
+void LogitechShifterG27::setUsedButtons(uint16_t mask) {
+	this->usedButtons = mask;
+	mask |= this->requiredButtons;
+
+	// the data is read MSB-first, so read down to the lowest used bit
+	uint8_t lowest = 0;
+	while (lowest < 15 && !(mask & (1 << lowest))) {
+		++lowest;
+	}
+	this->readLength = 16 - lowest;
+}
+
+void LogitechShifterG27::addRequiredButtons(uint16_t mask) {
+	this->requiredButtons |= mask;
+	this->setUsedButtons(this->usedButtons);  // recalculate the read length
+}
+
 bool LogitechShifterG27::buttonsChanged() const {
 	return this->buttonStates != this->previousButtons;
 }
@@ -1400,8 +3261,8 @@ bool LogitechShifterG27::readReverseButton() {
 * Static calibration constants
 * These values are arbitrary - just what worked well with my own shifter.
 */
-const float LogitechShifterG25::CalEngagementPoint = 0.70;
-const float LogitechShifterG25::CalReleasePoint = 0.50;
+const Fraction LogitechShifterG25::CalEngagementPoint = 0.70;
+const Fraction LogitechShifterG25::CalReleasePoint = 0.50;
 
 LogitechShifterG25::LogitechShifterG25(
 	PinNum pinX, PinNum pinY,
@@ -1419,9 +3280,19 @@ LogitechShifterG25::LogitechShifterG25(
 	sequentialProcess(false),  // not in sequential mode
 	sequentialState(0)         // no sequential buttons pressed
 {
+	// the sequential button is needed to switch modes
+	this->addRequiredButtons(1 << (uint8_t) Button::BUTTON_SEQUENTIAL);
+
 	// using the calibration values from my own G25 shifter
-	this->setCalibration({ 508, 435 }, { 310, 843 }, { 303, 8 }, { 516, 827 }, { 540, 14 }, { 713, 846 }, { 704, 17 });
-	this->setCalibrationSequential(425, 619, 257);
+	this->setCalibration(
+		{ fromTenBit(508), fromTenBit(435) },
+		{ fromTenBit(310), fromTenBit(843) },
+		{ fromTenBit(303), fromTenBit(8) },
+		{ fromTenBit(516), fromTenBit(827) },
+		{ fromTenBit(540), fromTenBit(14) },
+		{ fromTenBit(713), fromTenBit(846) },
+		{ fromTenBit(704), fromTenBit(17) });
+	this->setCalibrationSequential(fromTenBit(425), fromTenBit(619), fromTenBit(257));
 }
 
 void LogitechShifterG25::begin() {
@@ -1446,6 +3317,7 @@ bool LogitechShifterG25::updateState(bool connected) {
 
 		// force neutral gear, ignoring the H-pattern selection
 		this->setGear(0);
+		this->cancelShift();
 
 		// edge case: if we've not just switched into sequential mode,
 		// we need to ignore the H-pattern gear change (to 2/4, and then
@@ -1456,7 +3328,7 @@ bool LogitechShifterG25::updateState(bool connected) {
 		}
 
 		// read the raw y axis value, ignoring the H-pattern calibration
-		const int y = this->getPositionRaw(Axis::Y);
+		const AnalogValue y = this->getPositionRaw(Axis::Y);
 
 		// save the previous state for reference
 		const int8_t prevState = this->sequentialState;
@@ -1515,10 +3387,10 @@ bool LogitechShifterG25::getShiftDown() const {
 	return this->sequentialState == -1;
 }
 
-void LogitechShifterG25::setCalibrationSequential(int neutral, int up, int down, float engagePoint, float releasePoint) {
+void LogitechShifterG25::setCalibrationSequential(AnalogValue neutral, AnalogValue up, AnalogValue down, Fraction engagePoint, Fraction releasePoint) {
 	// limit percentage thresholds
-	engagePoint  = floatPercent(engagePoint);
-	releasePoint = floatPercent(releasePoint);
+	engagePoint  = clampFraction(engagePoint);
+	releasePoint = clampFraction(releasePoint);
 
 	// prevent release point from being higher than engage
 	// (which will prevent the shifter from working at all)
@@ -1527,15 +3399,15 @@ void LogitechShifterG25::setCalibrationSequential(int neutral, int up, int down,
 	}
 
 	// calculate ranges
-	const int upRange   = up - neutral;
-	const int downRange = neutral - down;
+	const AnalogValue upRange   = up - neutral;
+	const AnalogValue downRange = neutral - down;
 
 	// calculate calibration points
-	this->seqCalibration.upTrigger   = neutral + (upRange * engagePoint);
-	this->seqCalibration.upRelease   = neutral + (upRange * releasePoint);
+	this->seqCalibration.upTrigger   = neutral + scaleFraction(upRange, engagePoint);
+	this->seqCalibration.upRelease   = neutral + scaleFraction(upRange, releasePoint);
 
-	this->seqCalibration.downTrigger = neutral - (downRange * engagePoint);
-	this->seqCalibration.downRelease = neutral - (downRange * releasePoint);
+	this->seqCalibration.downTrigger = neutral - scaleFraction(downRange, engagePoint);
+	this->seqCalibration.downRelease = neutral - scaleFraction(downRange, releasePoint);
 }
 
 void LogitechShifterG25::serialCalibrationSequential(Stream& iface) {
@@ -1577,19 +3449,19 @@ void LogitechShifterG25::serialCalibrationSequential(Stream& iface) {
 		}
 	}
 
-	float engagementPoint = LogitechShifterG25::CalEngagementPoint;
-	float releasePoint = LogitechShifterG25::CalReleasePoint;
+	Fraction engagementPoint = LogitechShifterG25::CalEngagementPoint;
+	Fraction releasePoint = LogitechShifterG25::CalReleasePoint;
 
 	const uint8_t NumPoints = 3;
 	const char* directions[2] = {
 		"up",
 		"down",
 	};
-	int data[NumPoints];
+	AnalogValue data[NumPoints];
 
-	int& neutral = data[0];
-	int& yMax    = data[1];
-	int& yMin    = data[2];
+	AnalogValue& neutral = data[0];
+	AnalogValue& yMax    = data[1];
+	AnalogValue& yMin    = data[2];
 
 	for (uint8_t i = 0; i < NumPoints; ++i) {
 		if (i == 0) {
@@ -1611,10 +3483,12 @@ void LogitechShifterG25::serialCalibrationSequential(Stream& iface) {
 	iface.println(F("These settings are optional. Send 'y' to customize. Send any other character to continue with the default values."));
 
 	iface.print(F("  * Shift Engagement Point: \t"));
-	iface.println(engagementPoint);
+	printFraction(iface, engagementPoint);
+	iface.println();
 
 	iface.print(F("  * Shift Release Point:   \t"));
-	iface.println(releasePoint);
+	printFraction(iface, releasePoint);
+	iface.println();
 
 	iface.println();
 
@@ -1622,11 +3496,11 @@ void LogitechShifterG25::serialCalibrationSequential(Stream& iface) {
 
 	if (iface.read() == 'y') {
 		iface.println(F("Set the engagement point as a floating point percentage. This is the percentage away from the neutral axis on Y to start shifting."));
-		readFloat(engagementPoint, iface);
+		readFraction(engagementPoint, iface);
 		iface.println();
 
 		iface.println(F("Set the release point as a floating point percentage. This is the percentage away from the neutral axis on Y to stop shifting. It must be less than the engagement point."));
-		readFloat(releasePoint, iface);
+		readFraction(releasePoint, iface);
 		iface.println();
 	}
 
@@ -1648,9 +3522,9 @@ void LogitechShifterG25::serialCalibrationSequential(Stream& iface) {
 	iface.print(yMin);
 	iface.print(", ");
 
-	iface.print(engagementPoint);
+	printFraction(iface, engagementPoint);
 	iface.print(", ");
-	iface.print(releasePoint);
+	printFraction(iface, releasePoint);
 	iface.print(");");
 	iface.println();
 
@@ -1686,8 +3560,8 @@ bool Handbrake::updateState(bool connected) {
 
 	// otherwise, set axis to its minimum (idle) position
 	else {
-		const int min  = this->analogAxis.getMin();
-		const int prev = this->analogAxis.getPositionRaw();
+		const AnalogValue min  = this->analogAxis.getMin();
+		const AnalogValue prev = this->analogAxis.getPositionRaw();
 
 		if (min != prev) {
 			this->analogAxis.setPosition(min);
@@ -1702,7 +3576,7 @@ long Handbrake::getPosition(long rMin, long rMax) const {
 	return analogAxis.getPosition(rMin, rMax);
 }
 
-int Handbrake::getPositionRaw() const {
+AnalogValue Handbrake::getPositionRaw() const {
 	return analogAxis.getPositionRaw();
 }
 
@@ -1711,6 +3585,18 @@ void Handbrake::setCalibration(AnalogInput::Calibration newCal) {
 	analogAxis.setPosition(analogAxis.getMin());  // reset to min
 }
 
+void Handbrake::setFilter(AnalogInput::FilterType type, uint8_t strength, uint8_t speed) {
+	analogAxis.setFilter(type, strength, speed);
+}
+
+void Handbrake::setOversampling(uint8_t bits) {
+	analogAxis.setOversampling(bits);
+}
+
+void Handbrake::setDeadband(uint8_t counts, bool adaptive) {
+	analogAxis.setDeadband(counts, adaptive);
+}
+
 void Handbrake::serialCalibration(Stream& iface) {
 	if (isConnected() == false) {
 		iface.print(F("Error! Cannot perform calibration, "));
@@ -1773,5 +3659,216 @@ void Handbrake::serialCalibration(Stream& iface) {
 
 	flushClient(iface);
 }
+
+
+#if SIM_RACING_TRACE
+//#########################################################
+//                        Trace                           #
+//#########################################################
+
+/**
+* Zigzag encodes a signed value, so that small negative values
+* are small unsigned values (0, -1, 1, -2 -> 0, 1, 2, 3)
+*
+* @param value the value to encode
+* @return the encoded value
+*/
+static uint32_t zigzagEncode(int32_t value) {
+	return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+/**
+* Decodes a zigzag encoded value
+*
+* @param value the value to decode
+* @return the decoded value
+* @see zigzagEncode()
+*/
+static int32_t zigzagDecode(uint32_t value) {
+	return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+}
+
+static const char TraceMagic[3] = { 'S', 'R', 'T' };  ///< first bytes of the trace header
+
+TraceRecorder::TraceRecorder(Print& out)
+	: out(out), numChannels(0), size(0), count(0)
+{}
+
+void TraceRecorder::begin() {
+	this->numChannels = 0;
+	this->size = 0;
+	this->count = 0;
+
+	for (uint8_t i = 0; i < sizeof(TraceMagic); ++i) {
+		this->out.write((uint8_t) TraceMagic[i]);
+	}
+	this->out.write(TraceFormat::Version);
+	this->size += TraceFormat::HeaderSize;
+}
+
+uint16_t TraceRecorder::onRead(TraceSource source, PinNum pin, uint16_t value) {
+	this->record(source, pin, value, micros());
+	return value;
+}
+
+bool TraceRecorder::record(TraceSource source, PinNum pin, uint16_t value, uint32_t time) {
+	using namespace TraceFormat;
+
+	uint8_t index = 0;
+	while (index < this->numChannels && (this->channels[index].source != source || this->channels[index].pin != pin)) {
+		index++;
+	}
+
+	// new channel, define it. Channels start at 0 with the
+	// time at 0, so the first record has the time in full.
+	if (index == this->numChannels) {
+		if (this->numChannels >= MaxChannels) return false;
+
+		this->channels[index] = { source, pin, 0, 0, 0 };
+		this->numChannels++;
+
+		this->out.write(ChannelDefine);
+		this->out.write((uint8_t) source);
+		this->out.write((uint8_t) pin);
+		this->size += 3;
+	}
+
+	Channel& ch = this->channels[index];
+
+	const uint32_t interval = time - ch.time;
+	const int32_t adjustment = (int32_t) (interval - ch.interval);
+	const int32_t delta = (int32_t) value - (int32_t) ch.value;
+
+	uint8_t tag = index;
+	if (adjustment != 0) tag |= TimeFlag;
+
+	ValueCode code = ValueDelta;
+	if (delta == 0) code = ValueSame;
+	else if (delta == 1) code = ValueUp;
+	else if (delta == -1) code = ValueDown;
+	tag |= (code << ValueShift);
+
+	this->out.write(tag);
+	this->size++;
+
+	if (adjustment != 0) writeVarint(zigzagEncode(adjustment));
+	if (code == ValueDelta) writeVarint(zigzagEncode(delta));
+
+	ch.value = value;
+	ch.time = time;
+	ch.interval = interval;
+
+	this->count++;
+	return true;
+}
+
+void TraceRecorder::writeVarint(uint32_t value) {
+	while (value >= 0x80) {
+		this->out.write((uint8_t) (value | 0x80));
+		this->size++;
+		value >>= 7;
+	}
+	this->out.write((uint8_t) value);
+	this->size++;
+}
+
+TraceReader::TraceReader(Stream& in)
+	: in(in), numChannels(0), valid(false)
+{}
+
+bool TraceReader::begin() {
+	this->numChannels = 0;
+	this->valid = false;
+
+	for (uint8_t i = 0; i < sizeof(TraceMagic); ++i) {
+		if (this->in.read() != TraceMagic[i]) return false;
+	}
+	if (this->in.read() != TraceFormat::Version) return false;
+
+	this->valid = true;
+	return true;
+}
+
+bool TraceReader::read(Record& rec) {
+	using namespace TraceFormat;
+
+	if (!this->valid) return false;
+
+	int tag = this->in.read();
+	if (tag < 0) return false;  // end of the trace
+
+	// channel definition, followed by the record
+	if ((tag & ChannelMask) == ChannelDefine) {
+		const int source = this->in.read();
+		const int pin = this->in.read();
+
+		if (source < 0 || pin < 0 || this->numChannels >= MaxChannels) {
+			this->valid = false;
+			return false;
+		}
+
+		this->channels[this->numChannels] = { (TraceSource) source, (PinNum) pin, 0, 0, 0 };
+		this->numChannels++;
+
+		tag = this->in.read();
+		if (tag < 0) {
+			this->valid = false;
+			return false;
+		}
+	}
+
+	const uint8_t index = tag & ChannelMask;
+	if (index >= this->numChannels) {
+		this->valid = false;
+		return false;
+	}
+	Channel& ch = this->channels[index];
+
+	uint32_t adjustment = 0;
+	if ((tag & TimeFlag) && !readVarint(adjustment)) return false;
+
+	int32_t delta = 0;
+	switch ((ValueCode) (tag >> ValueShift)) {
+	case(ValueSame):
+		break;
+	case(ValueUp):
+		delta = 1;
+		break;
+	case(ValueDown):
+		delta = -1;
+		break;
+	case(ValueDelta):
+		uint32_t encoded;
+		if (!readVarint(encoded)) return false;
+		delta = zigzagDecode(encoded);
+		break;
+	}
+
+	ch.interval += (uint32_t) zigzagDecode(adjustment);
+	ch.time += ch.interval;
+	ch.value = (uint16_t) ((int32_t) ch.value + delta);
+
+	rec.source = ch.source;
+	rec.pin = ch.pin;
+	rec.value = ch.value;
+	rec.time = ch.time;
+	return true;
+}
+
+bool TraceReader::readVarint(uint32_t& value) {
+	value = 0;
+	for (uint8_t shift = 0; shift < 35; shift += 7) {
+		const int c = this->in.read();
+		if (c < 0) break;
+
+		value |= (uint32_t) (c & 0x7F) << shift;
+		if (!(c & 0x80)) return true;
+	}
+
+	this->valid = false;  // truncated or too long
+	return false;
+}
+#endif
 	
+}  // end configuration namespace
 };  // end SimRacing namespace
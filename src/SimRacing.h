@@ -30,7 +30,80 @@
 * @brief Header file for the Sim Racing Library
 */
 
+#ifndef SIM_RACING_ADC_BITS
+/**
+* Resolution of the analog to digital converter (ADC) used by the analog
+* inputs, in bits. Defaults to the 10-bit ADC of the AVR boards, and can be
+* set between 8 and 16 bits for boards with higher resolution converters.
+*
+* This must be defined for the whole build (e.g. as a compiler flag) so
+* that the library and the sketch agree on it, and analogRead() must
+* return values of the same resolution (e.g. by calling
+* analogReadResolution() in the sketch's setup()). A '#define' in the
+* sketch alone is not seen by the library, and fails to link.
+*
+* @see SIM_RACING_CONFIG
+*/
+#define SIM_RACING_ADC_BITS 10
+#endif
+
+#if (SIM_RACING_ADC_BITS < 8) || (SIM_RACING_ADC_BITS > 16)
+#error "SIM_RACING_ADC_BITS must be between 8 and 16"
+#endif
+
+#ifndef SIM_RACING_FIXED_POINT
+/**
+* Set to 1 to use fixed point math for the calibration thresholds rather
+* than floating point. On boards without a floating point unit this keeps
+* the floating point library out of the build, which saves flash and speeds
+* up calibration. Thresholds match the floating point math within one ADC
+* count. Use extras/tools/size_report.sh and the CalibrationTiming example
+* to measure the difference for a sketch.
+*
+* Like SIM_RACING_ADC_BITS, this must be defined for the whole build,
+* and a mismatch between the sketch and the library fails to link.
+*
+* @see Fraction
+* @see SIM_RACING_CONFIG
+*/
+#define SIM_RACING_FIXED_POINT 0
+#endif
+
+#ifndef SIM_RACING_TRACE
+/**
+* Set to 1 to build in the hooks for recording and replaying the raw
+* inputs read by the library (ADC readings, connection pins, and shift
+* register data).
+*
+* With this unset (the default) the hooks compile away to nothing.
+* Like SIM_RACING_ADC_BITS, this must be defined for the whole build.
+*
+* @see TraceHook
+*/
+#define SIM_RACING_TRACE 0
+#endif
+
+/// @cond
+#define SIM_RACING_CONFIG_NAME(bits, fixed) Config_ADC ## bits ## _Fixed ## fixed
+#define SIM_RACING_CONFIG_EXPAND(bits, fixed) SIM_RACING_CONFIG_NAME(bits, fixed)
+/// @endcond
+
+/**
+* Name of the inline namespace that holds the library, tagged with the
+* build configuration.
+*
+* The configuration changes the layout and behavior of the classes, so the
+* library and the sketch must be built with the same settings. Tagging the
+* namespace gives every symbol a different name for each configuration, so
+* a mismatch (e.g. SIM_RACING_ADC_BITS or SIM_RACING_FIXED_POINT defined
+* in the sketch, but not for the library) fails to link with an undefined
+* reference to 'SimRacing::Config_ADC..._Fixed...', rather than silently
+* mixing the two.
+*/
+#define SIM_RACING_CONFIG SIM_RACING_CONFIG_EXPAND(SIM_RACING_ADC_BITS, SIM_RACING_FIXED_POINT)
+
 namespace SimRacing {
+inline namespace SIM_RACING_CONFIG {
 	/**
 	* Type alias for pin numbers, using Arduino numbering
 	*/
@@ -42,6 +115,56 @@ namespace SimRacing {
 	*/
 	const PinNum UnusedPin = -1;
 
+	/**
+	* Type alias for analog (ADC) values. This is an 'int' unless the ADC
+	* range does not fit in one, so it is no wider than it needs to be.
+	*
+	* @see SIM_RACING_ADC_BITS
+	*/
+#if (SIM_RACING_ADC_BITS > 15) && (__INT_MAX__ < 0xFFFF)
+	using AnalogValue = long;
+#else
+	using AnalogValue = int;
+#endif
+
+	/**
+	* Type for fractions from 0 to 1, such as the calibration thresholds.
+	*
+	* This is a 'float' by default. If SIM_RACING_FIXED_POINT is set it is
+	* an unsigned Q0.16 fixed point value instead, which can still be set
+	* from a decimal constant (e.g. '0.70') that is converted at compile time.
+	*
+	* @see SIM_RACING_FIXED_POINT
+	*/
+#if SIM_RACING_FIXED_POINT
+	struct Fraction {
+		/**
+		* Converts a decimal value to a fraction, limited to 0-1
+		*
+		* This is meant for constants, which are converted at compile time.
+		* It's left implicit so that calls such as setCalibration(..., 0.70)
+		* work in both builds, but converting a value computed at run time
+		* brings back the floating point math this mode is meant to avoid.
+		*
+		* @param pct the decimal value
+		*/
+		constexpr Fraction(double pct = 0.0)
+			: value((pct <= 0.0) ? 0 : (pct >= 65535.5 / 65536.0) ? 0xFFFF : (uint16_t)(pct * 65536.0 + 0.5)) {}
+
+		/**
+		* Compares two fractions
+		*
+		* @param other the fraction to compare against
+		* @return 'true' if this fraction is greater than the other
+		*/
+		constexpr bool operator>(Fraction other) const { return value > other.value; }
+
+		uint16_t value;  ///< the fraction in Q0.16, where 0x10000 is 1
+	};
+#else
+	using Fraction = float;
+#endif
+
 
 	/**
 	* Enumeration for analog axis names, mapped to integers
@@ -52,12 +175,393 @@ namespace SimRacing {
 	};
 
 
+	/**
+	* @brief Fast digital I/O for a single pin
+	*
+	* On AVR, digitalRead() and digitalWrite() look up the pin's port and
+	* bit mask from program memory and check for a PWM timer on every call.
+	* This class resolves the port registers and bit mask once, so that
+	* reads and writes in the update loop are a single register access.
+	*
+	* The pin mode is *not* managed by this class, and should be set using
+	* pinMode() and digitalWrite() before use. An instance created for
+	* 'UnusedPin' always reads LOW and ignores writes.
+	*
+	* On other platforms this falls back to digitalRead() / digitalWrite().
+	*/
+	class FastPin {
+	public:
+		/**
+		* Class constructor
+		*
+		* @param pin the pin number to access (Arduino numbering)
+		*/
+		FastPin(PinNum pin);
+
+		/**
+		* Reads the state of the pin
+		*
+		* @return 'true' if the pin is HIGH, 'false' if it is LOW
+		*/
+		bool read() const {
+#if defined(__AVR__)
+			return (*inputReg & mask);
+#else
+			return digitalRead(pin);
+#endif
+		}
+
+		/**
+		* Sets the output state of the pin
+		*
+		* @param state 'true' to set the pin HIGH, 'false' to set it LOW
+		*/
+		void write(bool state) {
+#if defined(__AVR__)
+			// read-modify-write, so the port must be protected
+			// from any interrupts that write to it
+			const uint8_t sreg = SREG;
+			cli();
+			if (state) *outputReg |= mask;
+			else *outputReg &= ~mask;
+			SREG = sreg;
+#else
+			digitalWrite(pin, state);
+#endif
+		}
+
+	private:
+#if defined(__AVR__)
+		volatile uint8_t* inputReg;   ///< The port input register for the pin
+		volatile uint8_t* outputReg;  ///< The port output register for the pin
+		uint8_t mask;                 ///< The bit mask for the pin within its port
+#else
+		PinNum pin;                   ///< The pin number (Arduino numbering)
+#endif
+	};
+
+
+	/**
+	* @brief Debounces a packed word of digital inputs at once
+	*
+	* Each input has a 3-bit counter of the updates in a row that its raw
+	* state has differed from its debounced state. The counters are stored
+	* as bit planes (one word per counter bit), known as vertical counters,
+	* so every input in the word is counted at once with a handful of
+	* bitwise operations. An input changes state when its counter reaches
+	* its limit.
+	*
+	* @tparam T unsigned integer type, with one bit per input
+	*/
+	template<typename T>
+	class VerticalCounter {
+	public:
+		static const uint8_t MaxSamples = 8;  ///< Maximum number of updates to debounce an input over
+
+		/**
+		* Class constructor. Debouncing is disabled for all inputs.
+		*/
+		VerticalCounter() : count{ 0, 0, 0 }, limit{ 0, 0, 0 } {}
+
+		/**
+		* Sets the debounce time for a set of inputs
+		*
+		* @param mask    the inputs to set, one bit per input
+		* @param samples the number of updates in a row for an input to
+		*                change state, up to MaxSamples. 0 or 1 disables
+		*                debouncing.
+		*/
+		void setLimit(T mask, uint8_t samples) {
+			if (samples < 1) samples = 1;
+			else if (samples > MaxSamples) samples = MaxSamples;
+
+			// the limit is stored minus one, so it fits in three bits
+			const uint8_t value = samples - 1;
+			for (uint8_t i = 0; i < 3; ++i) {
+				if (value & (1 << i)) limit[i] |= mask;
+				else limit[i] &= (T) ~mask;
+
+				count[i] &= (T) ~mask;  // restart the count
+			}
+		}
+
+		/**
+		* Gets the debounce time for an input
+		*
+		* @param bit the bit number of the input
+		* @return the number of updates in a row for the input to change state
+		*/
+		uint8_t getLimit(uint8_t bit) const {
+			uint8_t value = 0;
+			for (uint8_t i = 0; i < 3; ++i) {
+				if (limit[i] & ((T) 1 << bit)) value |= (1 << i);
+			}
+			return value + 1;
+		}
+
+		/**
+		* Checks whether any of the inputs are debounced
+		*
+		* @return 'true' if any input has a debounce time, 'false' otherwise
+		*/
+		bool enabled() const { return (limit[0] | limit[1] | limit[2]) != 0; }
+
+		/**
+		* Debounces a new set of raw readings
+		*
+		* @param raw   the raw state of the inputs
+		* @param state the current debounced state of the inputs
+		* @return the new debounced state of the inputs
+		*/
+		T update(T raw, T state) {
+			// inputs that differ from their current state
+			const T delta = raw ^ state;
+
+			// inputs that have differed for long enough change state,
+			// which is when their counter matches their limit
+			const T done = delta & (T) ~(
+				(count[0] ^ limit[0]) |
+				(count[1] ^ limit[1]) |
+				(count[2] ^ limit[2]));
+
+			// count up the inputs that still differ, and reset the rest
+			const T active = delta & (T) ~done;
+			count[2] = (count[2] ^ (count[1] & count[0])) & active;
+			count[1] = (count[1] ^ count[0]) & active;
+			count[0] = (T) ~count[0] & active;
+
+			return state ^ done;
+		}
+
+		/**
+		* Resets the counters for all inputs, e.g. if the inputs were
+		* set directly
+		*/
+		void reset() { count[0] = count[1] = count[2] = 0; }
+
+	private:
+		T count[3];  ///< Number of updates in a row each input has differed from its state, as bit planes
+		T limit[3];  ///< Number of updates in a row for each input to change state minus one, as bit planes
+	};
+
+
+	/**
+	* @brief Reads data from a chain of parallel-in, serial-out shift
+	*        registers, such as the 74HC165
+	*
+	* The registers are latched, and then the data is clocked out one byte
+	* at a time, MSB-first. This is bit-banged by default, or can use the
+	* hardware SPI peripheral if the clock and data are wired to its pins.
+	*/
+	class ShiftRegisterBus {
+	public:
+		/**
+		* Class constructor
+		*
+		* @param pinLatch the pin to pulse to latch data
+		* @param pinClock the pin to pulse as a clock
+		* @param pinData  the pin to read data from
+		*/
+		ShiftRegisterBus(PinNum pinLatch, PinNum pinClock, PinNum pinData);
+
+		/**
+		* Checks whether all of the pins are set
+		*
+		* @return 'true' if the latch, clock, and data pins are set
+		*/
+		bool isValid() const;
+
+		/**
+		* Set the pin modes for all pins
+		*
+		* @param enabled 'true' to drive the latch and clock outputs,
+		*                'false' to leave them as high impedance
+		*/
+		void setPinModes(bool enabled);
+
+		/**
+		* Checks whether the outputs are being driven
+		*
+		* @return 'true' if the outputs are enabled, 'false' otherwise
+		*/
+		bool isEnabled() const { return this->enabled; }
+
+		/**
+		* Gets the pin used to read data from the registers
+		*
+		* @return the data pin (Arduino numbering)
+		*/
+		PinNum getDataPin() const { return this->pinData; }
+
+		/**
+		* Sets whether to read the registers using hardware SPI
+		*
+		* @param enabled 'true' to use hardware SPI, 'false' to bit-bang
+		*
+		* @return 'true' if hardware SPI is in use, 'false' if not (e.g.
+		*         the pins are not the SPI pins)
+		*/
+		bool setHardwareSPI(bool enabled = true);
+
+		/**
+		* Checks whether the registers are read using hardware SPI
+		*
+		* @return 'true' if hardware SPI is in use, 'false' otherwise
+		*/
+		bool usingHardwareSPI() const { return this->useSPI; }
+
+		/**
+		* Latches and reads the data from the registers
+		*
+		* @param data   the buffer to store the data in, with the first
+		*               byte shifted out at the start
+		* @param length the number of bytes to read
+		* @param fill   the byte to send out on the SPI output while
+		*               reading, if using hardware SPI
+		*
+		* @return 'true' if the data was read, 'false' if the outputs are
+		*         not enabled (data is zeroed)
+		*/
+		bool read(uint8_t* data, uint8_t length, uint8_t fill = 0x00) {
+			return this->readBits(data, length * 8, fill);
+		}
+
+		/**
+		* Latches and reads a number of bits from the registers, stopping
+		* early rather than clocking out the whole chain
+		*
+		* @param data   the buffer to store the data in, with the first
+		*               bit shifted out as the MSB of the first byte. Bits
+		*               that are not read are zeroed.
+		* @param bits   the number of bits to read. The buffer must hold
+		*               at least (bits + 7) / 8 bytes.
+		* @param fill   the byte to send out on the SPI output while
+		*               reading, if using hardware SPI
+		*
+		* @note Hardware SPI can only transfer whole bytes, so with SPI the
+		*       read is rounded up to the next byte and the extra bits are
+		*       discarded.
+		*
+		* @return 'true' if the data was read, 'false' if the outputs are
+		*         not enabled (data is zeroed)
+		*/
+		bool readBits(uint8_t* data, uint8_t bits, uint8_t fill = 0x00);
+
+		/**
+		* Reads the state of the data pin directly, without latching or
+		* clocking the registers
+		*
+		* @return the state of the data pin, or 'false' if the outputs
+		*         are not enabled
+		*/
+		bool readData() const;
+
+	private:
+		/**
+		* SPI clock speed, in Hz, when reading the shift registers with
+		* hardware SPI. Kept well below the shift register's limits to
+		* leave margin for the cable and series resistors.
+		*/
+		static const uint32_t SPIClockSpeed = 500000;
+
+		PinNum pinLatch;    ///< Pin to pulse to latch data
+		PinNum pinClock;    ///< Pin to pulse as a clock
+		PinNum pinData;     ///< Pin to use for reading data
+
+		FastPin fastLatch;  ///< Fast I/O access for the latch pin
+		FastPin fastClock;  ///< Fast I/O access for the clock pin
+		FastPin fastData;   ///< Fast I/O access for the data pin
+
+		bool enabled;       ///< Flag for whether the output pins are enabled / driven
+		bool useSPI;        ///< Flag for whether the registers are read using hardware SPI
+	};
+
+
+	/**
+	* @brief Shared timing for one update cycle (a 'frame')
+	*
+	* Takes a single micros() sample per frame, so that every peripheral
+	* updated in that frame shares the same time base instead of reading
+	* the clock on its own. This also counts the frames.
+	*
+	* @code{.cpp}
+	* SimRacing::Frame frame;
+	*
+	* void loop() {
+	*     frame.tick();
+	*     pedals.update(frame);
+	*     shifter.update(frame);
+	* }
+	* @endcode
+	*/
+	class Frame {
+	public:
+		/**
+		* Class constructor
+		*/
+		Frame();
+
+		/**
+		* Starts a new frame, sampling the clock and incrementing the
+		* frame counter
+		*/
+		void tick();
+
+		/**
+		* Retrieves the timestamp of the frame, in microseconds
+		*
+		* @return the frame timestamp, from micros()
+		*/
+		unsigned long getMicros() const { return this->timeMicros; }
+
+		/**
+		* Retrieves the timestamp of the frame, in milliseconds. This is
+		* kept from the same micros() sample, rather than reading millis().
+		*
+		* @return the frame timestamp, in ms
+		*/
+		unsigned long getMillis() const { return this->timeMillis; }
+
+		/**
+		* Retrieves the frame number, which is the number of times tick()
+		* has been called
+		*
+		* @return the frame number
+		*/
+		unsigned long getCount() const { return this->count; }
+
+	private:
+		unsigned long timeMicros;  ///< Timestamp of the frame, in us
+		unsigned long timeMillis;  ///< Timestamp of the frame, in ms
+		unsigned long remainder;   ///< Microseconds elapsed that have not yet been counted as a millisecond
+		unsigned long count;       ///< Number of frames started
+	};
+
+
 	/**
 	* @brief Used for tracking whether a device is connected to
 	* a specific pin and stable.
+	*
+	* By default the pin is read on every poll(). The connection can
+	* instead be detected by interrupt (see setInterruptMode()), where the
+	* pin changes are timestamped as they happen and poll() only checks a
+	* flag unless a plug / unplug is in progress.
+	*
+	* On AVR this uses the pin change interrupts. The interrupt vector is
+	* left for the sketch to define, so that the library does not claim it:
+	*
+	* @code{.cpp}
+	* ISR(PCINT0_vect) {
+	*     SimRacing::DeviceConnection::handlePinChange();
+	* }
+	* @endcode
+	*
+	* On other platforms this uses attachInterrupt(), if the pin supports it.
 	*/
 	class DeviceConnection {
 	public:
+		static const uint8_t MaxInterrupts = 4;  ///< Maximum number of connections that can be detected by interrupt
+
 		/**
 		* The state of the connection, whether it is connected, disconnected, and
 		* everywhere in-between. This is the type returned by the main 'getState()'
@@ -73,62 +577,364 @@ namespace SimRacing {
 		};
 
 		/**
-		* Class constructor
+		* Class constructor
+		*
+		* @param pin        the pin number being read. Can be 'UnusedPin' to disable.
+		* @param activeLow  whether the device is detected on a high signal (false, 
+		*                   default) or a low signal (true)
+		* @param detectTime the amount of time, in ms, the input must be stable for
+		*                   before it's interpreted as 'detected'
+		*/
+		DeviceConnection(PinNum pin, bool activeLow = false, unsigned long detectTime = 250);
+
+		/**
+		* Copy constructor
+		*
+		* The copy has the same pin, settings, and connection state. If the
+		* original detects changes by interrupt, the copy is added to the
+		* interrupt list as well, or falls back to polling if it's full.
+		*
+		* @param other the connection to copy
+		*/
+		DeviceConnection(const DeviceConnection& other);
+
+		/**
+		* Copy assignment operator
+		*
+		* @param other the connection to copy
+		* @return this connection
+		*
+		* @see DeviceConnection(const DeviceConnection&)
+		*/
+		DeviceConnection& operator=(const DeviceConnection& other);
+
+		/**
+		* Class destructor
+		*
+		* Removes the connection from the interrupt list. The pin change
+		* interrupt is left on if another connection uses the same pin.
+		*/
+		~DeviceConnection();
+
+		/**
+		* Checks if the pin detects a connection. This polls the input and checks
+		* for whether it has been connected sufficiently long enough to be
+		* deemed "stable".
+		*
+		* In interrupt mode the pin is not read, and this only checks the
+		* stable time while the connection is changing.
+		*/
+		void poll();
+
+		/**
+		* Checks if the pin detects a connection, using the frame's
+		* timestamp rather than reading the clock
+		*
+		* @param frame the frame being updated
+		* @see poll()
+		*/
+		void poll(const Frame& frame);
+
+		/**
+		* Sets whether pin changes are detected by interrupt, rather than by
+		* reading the pin on every poll
+		*
+		* @param enabled 'true' to detect pin changes by interrupt, 'false'
+		*                to read the pin on every poll
+		*
+		* @return 'true' if the mode was set, 'false' if the pin doesn't
+		*         support interrupts or too many connections use them
+		*
+		* @see MaxInterrupts
+		*/
+		bool setInterruptMode(bool enabled = true);
+
+		/**
+		* Checks if pin changes are detected by interrupt
+		*
+		* @return 'true' if detected by interrupt, 'false' if polled
+		*/
+		bool usingInterrupt() const { return this->interruptMode; }
+
+		/**
+		* Records the pin changes for every connection in interrupt mode.
+		*
+		* On AVR this must be called from the pin change interrupt service
+		* routine for the bank(s) the detection pins are on. On other
+		* platforms it is attached automatically.
+		*/
+		static void handlePinChange();
+
+		/**
+		* Retrieves the current ConnectionState from the instance. This
+		* allows functions to check the same connection state multiple times
+		* without having to re-poll.
+		*/
+		ConnectionState getState() const;
+
+		/**
+		* Check if the device is physically connected to the board. That means
+		* it is both present and detected long enough to be considered 'stable'.
+		*
+		* @return 'true' if the device is connected, 'false' otherwise
+		*/
+		bool isConnected() const;
+
+		/**
+		* Set how long the detection pin must be stable for before the device
+		* is considered to be 'connected'
+		*
+		* @param t the amount of time, in ms, the input must be stable for
+		*          (no changes) before it's interpreted as 'detected'
+		*/
+		void setStablePeriod(unsigned long t);
+
+	private:
+		/**
+		* Reads the state of the pin, compensating for inversion
+		*
+		* @return 'true' if the pin is detected, 'false' otherwise
+		*/
+		bool readPin() const;
+
+		/**
+		* Polls the connection, as with poll()
+		*
+		* @param frame pointer to the frame being updated, for its timestamp.
+		*              If this is null millis() is used instead.
+		*/
+		void pollFrame(const Frame* frame);
+
+		/**
+		* Records a pin change from the interrupt, if the pin has changed
+		*/
+		void recordPinChange();
+
+		PinNum pin;                  ///< The pin number being read from. Can be 'UnusedPin' to disable
+		FastPin fastPin;             ///< Fast I/O access for the pin being read from
+		bool inverted;               ///< Whether the input is inverted, so 'LOW' is detected instead of 'HIGH'
+		unsigned long stablePeriod;  ///< The amount of time the input must be stable for (ms)
+
+		ConnectionState state;       ///< The current state of the connection
+		bool pinState;               ///< Buffered state of the input pin, accounting for inversion
+		unsigned long lastChange;    ///< Timestamp of the last pin change, in ms (using millis())
+
+		bool interruptMode;                ///< Whether pin changes are detected by interrupt, rather than polled
+		volatile bool edgePending;         ///< Whether the pin changed in the interrupt since the last poll
+		volatile bool edgeState;           ///< State of the pin at the last change in the interrupt, accounting for inversion
+		volatile unsigned long edgeTime;   ///< Timestamp of the last pin change in the interrupt, in ms (using millis())
+
+		static DeviceConnection* interruptList[MaxInterrupts];  ///< Connections detected by interrupt
+	};
+
+
+	/**
+	* @brief Non-blocking background sampler for the analog to digital
+	* converter (ADC)
+	*
+	* By default every AnalogInput::read() call uses analogRead(), which
+	* blocks for the entire conversion (~110 us on AVR). When the sampler
+	* is running, the ADC instead cycles through all of the analog channels
+	* in use in the background, chaining one conversion after another, and
+	* AnalogInput::read() returns the latest cached sample for its pin
+	* without waiting.
+	*
+	* Channels are registered automatically when an AnalogInput is created,
+	* or otherwise the first time they are read. The channels are converted
+	* in a fixed order, the scan table, sorted by their multiplexer channel.
+	* Each channel's conversions (including any oversampling) are done
+	* back-to-back, so the multiplexer switches once per channel per scan.
+	*
+	* The first conversion after switching the multiplexer can be skewed by
+	* the previous channel, especially with high impedance potentiometers.
+	* To avoid this, the sampler throws away a number of conversions after
+	* each switch (see setSettling()). These are skipped if there is only one
+	* channel, as the multiplexer never switches.
+	*
+	* The conversions are advanced by service(), which is called on every
+	* read in polled mode, or can be called from the ADC interrupt:
+	*
+	* @code{.cpp}
+	* void setup() {
+	*     SimRacing::AnalogSampler::begin(true);  // interrupt-driven
+	* }
+	*
+	* ISR(ADC_vect) {
+	*     SimRacing::AnalogSampler::service();
+	* }
+	* @endcode
+	*
+	* The interrupt vector is left for the sketch to define so that the
+	* library does not claim it for users who never start the sampler.
+	*
+	* @note While the sampler is running it owns the ADC, and analogRead()
+	*       must not be called directly. The sampler uses the default (AVcc)
+	*       voltage reference. On platforms other than AVR the sampler is
+	*       never started and all reads fall back to analogRead().
+	*/
+	class AnalogSampler {
+	public:
+		static const uint8_t MaxChannels = 6;  ///< Maximum number of channels that can be sampled in the background
+		static const uint8_t DefaultSettling = 1;  ///< Default number of conversions to discard after switching channels
+
+		/**
+		* @brief One step of the scan table, converting a single channel
+		*/
+		struct ScanStep {
+			PinNum pin;           ///< the analog pin converted in this step (Arduino numbering)
+			uint8_t discards;     ///< the number of conversions thrown away after switching to this pin
+			uint8_t conversions;  ///< the number of conversions summed for the result
+		};
+
+		/**
+		* Starts sampling in the background
+		*
+		* @param useInterrupt 'true' to advance the conversions from the ADC
+		*                     interrupt, 'false' to advance them from read()
+		*/
+		static void begin(bool useInterrupt = false);
+
+		/**
+		* Stops sampling in the background, returning the ADC for use
+		* with analogRead()
+		*/
+		static void end();
+
+		/**
+		* Checks if the sampler is running in the background
+		*
+		* @return 'true' if the sampler is running, 'false' otherwise
+		*/
+		static bool isRunning() { return running; }
+
+		/**
+		* Retrieves the latest sample for a given analog pin. If the sampler
+		* is not running this is the same as calling analogRead().
+		*
+		* The sample can be oversampled and decimated for additional
+		* resolution. Each extra bit takes four times as many conversions:
+		* when running, the channel's conversions are done back-to-back and
+		* the decimated result is published once all of them are complete.
+		* When not running, the conversions are done on the spot with
+		* analogRead().
+		*
+		* @param pin       the analog pin to read (Arduino numbering)
+		* @param extraBits the number of bits of extra resolution to
+		*                  oversample for, 0-3
+		*
+		* @return the latest ADC value for the pin, scaled up by 2^extraBits
+		*/
+		static AnalogValue read(PinNum pin, uint8_t extraBits = 0);
+
+		/**
+		* Stores the result of a finished conversion and starts the next one.
+		* Does nothing if a conversion is still in progress.
+		*
+		* In interrupt mode this must be called from the 'ADC_vect' interrupt
+		* service routine, and *only* from there.
+		*/
+		static void service();
+
+		/**
+		* Blocks until a full scan of every channel has completed, so that
+		* all of the inputs read afterwards come from the same scan. If a
+		* scan is already in progress it is finished first, and then a
+		* fresh one is done.
+		*
+		* This is useful for reading all of the peripherals in a frame from
+		* a consistent set of samples. Does nothing if the sampler is not
+		* running. In interrupt mode this must not be called with
+		* interrupts disabled.
+		*/
+		static void scan();
+
+		/**
+		* Adds an analog pin to the scan table. If the sampler is running
+		* this also performs one blocking conversion to seed its result,
+		* otherwise the result is seeded by begin().
+		*
+		* This is called by AnalogInput when it's created, and does not need
+		* to be called by the user for pins read through the library.
+		*
+		* @param pin the analog pin to add (Arduino numbering)
+		* @return 'true' if the pin is in the table, 'false' if it is full
+		*/
+		static bool addPin(PinNum pin);
+
+		/**
+		* Sets the number of conversions to throw away after switching the
+		* multiplexer to a new channel
 		*
-		* @param pin        the pin number being read. Can be 'UnusedPin' to disable.
-		* @param activeLow  whether the device is detected on a high signal (false, 
-		*                   default) or a low signal (true)
-		* @param detectTime the amount of time, in ms, the input must be stable for
-		*                   before it's interpreted as 'detected'
+		* @param discards the number of conversions to discard, 0 for none
 		*/
-		DeviceConnection(PinNum pin, bool activeLow = false, unsigned long detectTime = 250);
+		static void setSettling(uint8_t discards);
 
 		/**
-		* Checks if the pin detects a connection. This polls the input and checks
-		* for whether it has been connected sufficiently long enough to be
-		* deemed "stable".
+		* Retrieves the number of conversions thrown away after switching
+		* the multiplexer to a new channel
+		*
+		* @return the number of conversions discarded per channel switch
 		*/
-		void poll();
+		static uint8_t getSettling() { return settling; }
 
 		/**
-		* Retrieves the current ConnectionState from the instance. This
-		* allows functions to check the same connection state multiple times
-		* without having to re-poll.
+		* Retrieves the number of steps in the scan table, one per channel
+		*
+		* @return the length of the scan table
 		*/
-		ConnectionState getState() const;
+		static uint8_t getScanLength() { return numChannels; }
 
 		/**
-		* Check if the device is physically connected to the board. That means
-		* it is both present and detected long enough to be considered 'stable'.
+		* Retrieves one step of the scan table, in the order the channels
+		* are converted
 		*
-		* @return 'true' if the device is connected, 'false' otherwise
+		* @param step the index of the step in the scan table
+		* @return the step's pin and conversion counts. The pin is
+		*         'UnusedPin' if the step is out of range.
 		*/
-		bool isConnected() const;
+		static ScanStep getScanStep(uint8_t step);
 
 		/**
-		* Set how long the detection pin must be stable for before the device
-		* is considered to be 'connected'
+		* Retrieves the number of full scans completed since the sampler
+		* was started
 		*
-		* @param t the amount of time, in ms, the input must be stable for
-		*          (no changes) before it's interpreted as 'detected'
+		* @return the number of completed scans
 		*/
-		void setStablePeriod(unsigned long t);
+		static unsigned long getScanCount();
 
 	private:
 		/**
-		* Reads the state of the pin, compensating for inversion
-		*
-		* @return 'true' if the pin is detected, 'false' otherwise
+		* Sorts the scan table by multiplexer channel
 		*/
-		bool readPin() const;
+		static void planScan();
 
-		PinNum pin;                  ///< The pin number being read from. Can be 'UnusedPin' to disable
-		bool inverted;               ///< Whether the input is inverted, so 'LOW' is detected instead of 'HIGH'
-		unsigned long stablePeriod;  ///< The amount of time the input must be stable for (ms)
+		/**
+		* Adds a new pin to the channel list. This performs one blocking
+		* (oversampled) conversion on the new channel to seed its result.
+		*
+		* @param pin       the analog pin to add (Arduino numbering)
+		* @param extraBits the number of bits of extra resolution to
+		*                  oversample for
+		*
+		* @return the ADC value for the pin
+		*/
+		static AnalogValue addChannel(PinNum pin, uint8_t extraBits);
 
-		ConnectionState state;       ///< The current state of the connection
-		bool pinState;               ///< Buffered state of the input pin, accounting for inversion
-		unsigned long lastChange;    ///< Timestamp of the last pin change, in ms (using millis())
+		static bool running;                            ///< Whether the sampler is running
+		static bool interruptMode;                      ///< Whether conversions are advanced from the ADC interrupt
+		static uint8_t numChannels;                     ///< Number of channels in the list
+		static volatile uint8_t current;                ///< Index of the channel being converted
+		static uint8_t step;                            ///< Index of the step in the scan table being converted
+		static uint8_t order[MaxChannels];              ///< Scan table, as the channel indices in the order they're converted
+		static uint8_t settling;                        ///< Number of conversions to discard after switching channels
+		static uint8_t discards;                        ///< Number of conversions left to discard for the current channel
+		static volatile unsigned long scanCount;        ///< Number of full scans completed
+		static PinNum pins[MaxChannels];                ///< Pin numbers for each channel (Arduino numbering)
+		static uint8_t muxes[MaxChannels];              ///< ADC multiplexer selection for each channel
+		static volatile uint16_t results[MaxChannels];  ///< The latest sample for each channel
+		static uint8_t oversampling[MaxChannels];       ///< The number of extra bits to oversample each channel for
+		static uint16_t accumulator;                    ///< Sum of the conversions for the current channel, when oversampling
+		static uint8_t conversions;                     ///< Number of conversions summed for the current channel
 	};
 
 
@@ -137,8 +943,10 @@ namespace SimRacing {
 	*/
 	class AnalogInput {
 	public:
-		static const int Min = 0;     ///< Minimum value of the analog to digital (ADC) converter
-		static const int Max = 1023;  ///< Maximum value of the analog to digital (ADC) converter. 10-bit by default.
+		static const uint8_t Resolution = SIM_RACING_ADC_BITS;  ///< Resolution of the analog to digital (ADC) converter, in bits. 10-bit by default.
+		static const AnalogValue Min = 0;  ///< Minimum value of the analog to digital (ADC) converter
+		static const AnalogValue Max = ((AnalogValue) 1 << Resolution) - 1;  ///< Maximum value of the analog to digital (ADC) converter
+		static const uint8_t MaxOversampling = (16 - Resolution) / 2;  ///< Maximum number of extra bits of resolution from oversampling, so the sum of 4^n conversions fits in 16 bits
 
 		/**
 		* Class constructor
@@ -150,6 +958,9 @@ namespace SimRacing {
 		/**
 		* Updates the current value of the axis by polling the ADC
 		*
+		* If the AnalogSampler is running, this picks up the latest
+		* background sample rather than waiting on a new conversion.
+		*
 		* @return 'true' if the value changed, 'false' otherwise
 		*/
 		virtual bool read();
@@ -161,6 +972,11 @@ namespace SimRacing {
 		* By default this is rescaled to a 10-bit value, matching the range
 		* used by the AVR analog to digital converter (ADC).
 		*
+		* The scaling factor for the most recently requested output range is
+		* precomputed in fixed-point, so repeated calls with the same range
+		* take one multiply and one shift rather than a division. The result
+		* is identical to the Arduino map() function, with range limits.
+		*
 		* @param rMin the minimum output value for the rescaling function
 		* @param rMax the maximum output value for the rescaling function
 		*
@@ -173,21 +989,21 @@ namespace SimRacing {
 		*
 		* @return the axis position, buffered
 		*/
-		int getPositionRaw() const;
+		AnalogValue getPositionRaw() const;
 
 		/**
 		* Retrieves the calibrated minimum position.
 		*
 		* @return the minimum position for the axis, per the calibration
 		*/
-		int getMin() const { return this->cal.min; }
+		AnalogValue getMin() const { return this->cal.min; }
 
 		/**
 		* Retrieves the calibrated maximum position.
 		*
 		* @return the maximum position for the axis, per the calibration
 		*/
-		int getMax() const { return this->cal.max; }
+		AnalogValue getMax() const { return this->cal.max; }
 
 		/**
 		* Check whether the axis is inverted or not.
@@ -204,7 +1020,7 @@ namespace SimRacing {
 		*
 		* @param newPos the new position value to set
 		*/
-		void setPosition(int newPos);
+		void setPosition(AnalogValue newPos);
 
 		/**
 		* Set the 'inverted' state of the axis. This will return a flipped
@@ -227,8 +1043,8 @@ namespace SimRacing {
 		* @see https://stackoverflow.com/a/18184210
 		*/
 		struct Calibration {
-			int min;  ///< Minimum value of the analog axis
-			int max;  ///< Maximum value of the analog axis
+			AnalogValue min;  ///< Minimum value of the analog axis
+			AnalogValue max;  ///< Maximum value of the analog axis
 		};
 
 		/**
@@ -238,10 +1054,212 @@ namespace SimRacing {
 		*/
 		void setCalibration(Calibration newCal);
 
+		/**
+		* @brief Filter types for smoothing the ADC readings
+		*
+		* @see setFilter()
+		*/
+		enum FilterType : uint8_t {
+			FilterNone,     ///< No filtering, the ADC readings are used as-is (default)
+			FilterEMA,      ///< Exponential moving average
+			FilterMedian,   ///< Median of the last 3 or 5 readings, rejecting spikes
+			FilterOneEuro,  ///< Adaptive low-pass, smoothing heavily at rest and lightly while moving ("One Euro" filter)
+		};
+
+		/**
+		* Sets the filter used to smooth the ADC readings before they are
+		* stored as the axis position. Filtering happens within read(), so
+		* noise that is filtered out will not set the 'changed' flag.
+		*
+		* All filters use integer math only, and their state is stored within
+		* the class instance.
+		*
+		* The 'strength' parameter depends on the filter type:
+		*   * FilterEMA: the smoothing factor as a power of two, 1-7. Each
+		*     reading moves the output by 1 / 2^strength. Default is 2.
+		*   * FilterMedian: the number of readings in the window, 3 or 5.
+		*     Default is 3.
+		*   * FilterOneEuro: the smoothing factor at rest as a power of two,
+		*     1-7, in the same manner as FilterEMA. Default is 4.
+		*
+		* The 'speed' parameter is only used with FilterOneEuro. It sets how
+		* quickly the smoothing is reduced as the input moves faster. Higher
+		* values reduce lag when moving at the expense of more noise. Default
+		* is 16.
+		*
+		* @param type     the filter type to use
+		* @param strength the amount of filtering to apply, or 0 for default
+		* @param speed    the filter speed coefficient, or 0 for default
+		*/
+		void setFilter(FilterType type, uint8_t strength = 0, uint8_t speed = 0);
+
+		/**
+		* Retrieves the type of filter used to smooth the ADC readings
+		*
+		* @return the current filter type
+		* @see setFilter()
+		*/
+		FilterType getFilter() const { return this->filter.type; }
+
+		/**
+		* Sets the number of bits of extra resolution to read from the ADC
+		* by oversampling and decimation, up to 3 (for 13 bits on AVR).
+		*
+		* Each reading sums 4^bits conversions and scales the sum down by
+		* 2^bits, so the raw position, the calibration, and the range of
+		* getPositionRaw() are all scaled up by 2^bits. The existing
+		* calibration is rescaled to match when this is changed. To get the
+		* extra resolution out of getPosition(), pass an output range that
+		* is wider than the default.
+		*
+		* This relies on there being at least one count of noise on the
+		* input, which is typical for potentiometers. The cost is four
+		* times as many conversions per extra bit. With the blocking
+		* analogRead() on AVR at ~110 us per conversion, one reading takes
+		* ~0.45 ms for 1 bit, ~1.8 ms for 2 bits, and ~7 ms for 3 bits.
+		* With the AnalogSampler running the reads don't block, but each
+		* channel is updated that many times less often.
+		*
+		* @param bits the number of extra bits of resolution, 0-3
+		*/
+		void setOversampling(uint8_t bits);
+
+		/**
+		* Retrieves the number of bits of extra resolution read from the ADC
+		*
+		* @return the number of extra bits, 0-3
+		* @see setOversampling()
+		*/
+		uint8_t getOversampling() const { return this->oversampling; }
+
+		/**
+		* Sets a deadband for the change detection in read(), so that small
+		* changes in position do not set the 'changed' flag. This suppresses
+		* redundant updates (e.g. USB reports) caused by noise.
+		*
+		* A change is only reported once the position has moved *more* than
+		* the deadband away from the last reported position. Reaching either
+		* end of the calibrated range is always reported.
+		*
+		* In adaptive mode the deadband is widened by twice the measured
+		* noise, which is the average change between successive readings
+		* while the axis is (roughly) still.
+		*
+		* @param counts   the deadband, in ADC counts. 0 reports every change.
+		* @param adaptive whether to widen the deadband by the measured noise
+		*/
+		void setDeadband(uint8_t counts, bool adaptive = false);
+
+		/**
+		* Retrieves the deadband for the change detection, including any
+		* adaptive widening from the measured noise
+		*
+		* @return the current deadband, in ADC counts
+		* @see setDeadband()
+		*/
+		int getDeadband() const;
+
+		/**
+		* Retrieves the number of position changes that were not reported
+		* as 'changed' because they were within the deadband
+		*
+		* @return the number of suppressed changes
+		*/
+		unsigned long getSuppressedCount() const { return this->suppressed; }
+
 	private:
+		/**
+		* Checks whether the position has moved far enough from the last
+		* reported position to be reported as a change.
+		*
+		* @return 'true' if the change should be reported, 'false' otherwise
+		*/
+		bool exceedsDeadband() const;
+
+		/**
+		* Updates the running noise estimate with the difference between
+		* two successive positions
+		*
+		* @param delta the absolute difference between the positions
+		*/
+		void updateNoise(AnalogValue delta);
+
+		/**
+		* Runs a new ADC reading through the filter, updating the filter state
+		*
+		* @param value the raw ADC reading
+		* @return the filtered reading
+		*/
+		AnalogValue applyFilter(AnalogValue value);
+
+		/**
+		* Resets the filter state as if it has settled at a given value
+		*
+		* @param value the value to settle the filter at
+		*/
+		void resetFilter(AnalogValue value);
+
+		/**
+		* Precomputes the fixed-point scaling factor for a given output
+		* range, using the current calibration.
+		*
+		* If the range is too large to rescale exactly in 32 bits, the cache
+		* is marked invalid and getPosition() falls back to division.
+		*
+		* @param rMin the minimum output value for the rescaling function
+		* @param rMax the maximum output value for the rescaling function
+		*/
+		void updateScaling(long rMin, long rMax) const;
+
+		/**
+		* @brief Cached fixed-point scaling factor for getPosition()
+		*/
+		struct Scaling {
+			long outMin;      ///< the output range minimum the factor was computed for
+			long outMax;      ///< the output range maximum the factor was computed for
+			uint32_t factor;  ///< the fixed-point multiplier, output range / input range
+			uint8_t shift;    ///< the number of fractional bits in the multiplier
+			bool valid;       ///< whether the factor can be used for exact rescaling
+		};
+
+		/**
+		* @brief Filter configuration and state, stored inline
+		*/
+		struct Filter {
+			static const uint8_t MaxWindow = 5;  ///< the maximum number of readings for the median filter
+
+			FilterType type;   ///< the type of filter in use
+			uint8_t strength;  ///< the amount of filtering (meaning depends on type)
+			uint8_t speed;     ///< the speed coefficient, for the One Euro filter
+			bool primed;       ///< whether the state holds a reading, or must be reset on the next one
+
+			union {
+				long accumulator;          ///< EMA: the running average, scaled by 2^strength
+
+				struct {
+					AnalogValue readings[MaxWindow];  ///< the most recent readings
+					uint8_t index;            ///< the index to write the next reading to
+				} median;                     ///< Median: the reading window
+
+				struct {
+					long value;  ///< the filtered value, in 1/16ths of a count
+					long slope;  ///< the smoothed rate of change, in 1/16ths of a count per reading
+				} euro;          ///< One Euro: the filtered value and its rate of change
+			};
+		};
+
 		PinNum pin;              ///< the digital pin number for this input
-		int position;            ///< the axis' position in its range, buffered
+		AnalogValue position;    ///< the axis' position in its range, buffered
 		Calibration cal;         ///< the calibration values for the axis
+		mutable Scaling scaling; ///< the precomputed scaling for the last output range
+		Filter filter;           ///< the filter for the ADC readings
+		uint8_t oversampling;    ///< the number of extra bits of resolution to oversample for
+
+		AnalogValue reported;    ///< the position when a change was last reported
+		uint8_t deadband;        ///< the minimum change in position to report, in ADC counts
+		bool adaptive;           ///< whether the deadband is widened by the measured noise
+		uint16_t noise;          ///< the average change between readings at rest, in 1/256ths of a count
+		unsigned long suppressed; ///< the number of changes suppressed by the deadband
 	};
 
 
@@ -267,6 +1285,16 @@ namespace SimRacing {
 		*/
 		bool update();
 
+		/**
+		* Perform a poll of the hardware to refresh the class state, using
+		* the timing of a shared frame rather than reading the clock
+		*
+		* @param frame the frame being updated, after calling Frame::tick()
+		*
+		* @returns 'true' if device state changed, 'false' otherwise
+		*/
+		bool update(const Frame& frame);
+
 		/**
 		* Check if the device is physically connected to the board. That means
 		* it is both present and detected long enough to be considered 'stable'.
@@ -278,7 +1306,49 @@ namespace SimRacing {
 		/** @copydoc DeviceConnection::setStablePeriod(unsigned long) */
 		void setStablePeriod(unsigned long t);
 
+		/**
+		* Sets whether the device connection is detected by interrupt,
+		* rather than by reading the detection pin on every update
+		*
+		* @param enabled 'true' to detect by interrupt, 'false' to poll
+		*
+		* @return 'true' if the mode was set, 'false' if the detection pin
+		*         doesn't support interrupts or the peripheral has no
+		*         detection pin
+		*
+		* @see DeviceConnection::setInterruptMode()
+		*/
+		bool setDetectInterrupt(bool enabled = true);
+
 	protected:
+		/**
+		* Class constructor
+		*/
+		Peripheral() : detector(nullptr), frame(nullptr) {}
+
+		/**
+		* Retrieves the frame being updated, if the peripheral was updated
+		* with one. This is only valid within updateState().
+		*
+		* @returns pointer to the frame, or nullptr if there is none
+		*/
+		const Frame* getFrame() const { return this->frame; }
+
+		/**
+		* Polls the detector (if any) for the connection state
+		*
+		* @param f pointer to the frame being updated, or nullptr
+		* @returns 'true' if the device is connected, 'false' otherwise
+		*/
+		bool pollConnection(const Frame* f);
+
+		/**
+		* Sets the frame being updated, for getFrame()
+		*
+		* @param f pointer to the frame being updated, or nullptr
+		*/
+		void setFrame(const Frame* f) { this->frame = f; }
+
 		/**
 		* Perform an internal poll of the hardware to refresh the class state
 		* 
@@ -308,7 +1378,195 @@ namespace SimRacing {
 		void setDetectPtr(DeviceConnection* d);
 
 	private:
+		/**
+		* Refreshes the class state, as with update()
+		*
+		* @param f pointer to the frame being updated, or nullptr
+		* @returns 'true' if device state changed, 'false' otherwise
+		*/
+		bool updateFrame(const Frame* f);
+
 		DeviceConnection* detector;  ///< Pointer to a device connection instance
+		const Frame* frame;          ///< Pointer to the frame being updated, only set within update()
+	};
+
+
+	/**
+	* @brief Statically dispatched form of a peripheral
+	*
+	* Peripheral::update() calls the device's updateState() through the
+	* virtual table. This wraps a concrete peripheral class so that update()
+	* calls its updateState() directly instead, saving one indirect call per
+	* update.
+	*
+	* That is the only saving, and it is small: the load of the function
+	* pointer from the virtual table, about ten cycles on AVR. updateState()
+	* itself is compiled within the library, so the calls it makes (e.g.
+	* AnalogInput::read(), or reading the shifter's reverse button) are
+	* virtual either way.
+	*
+	* The wrapper takes the same constructor arguments as the device:
+	*
+	* @code{.cpp}
+	* SimRacing::StaticPeripheral<SimRacing::LogitechShifterG27> shifter(
+	*     SHIFTER_X_PIN, SHIFTER_Y_PIN,
+	*     SHIFTER_LATCH_PIN, SHIFTER_CLOCK_PIN, SHIFTER_DATA_PIN);
+	* @endcode
+	*
+	* @note Static dispatch only applies when update() is called on the
+	*       wrapper itself. Updating it through a Peripheral reference or
+	*       pointer (e.g. with the Scheduler) uses the virtual version.
+	*
+	* @tparam Device the concrete peripheral class
+	*/
+	template<class Device>
+	class StaticPeripheral final : public Device {
+	public:
+		using Device::Device;  // same constructors as the device
+
+		/** @copydoc Peripheral::update() */
+		bool update() { return this->updateFrame(nullptr); }
+
+		/** @copydoc Peripheral::update(const Frame&) */
+		bool update(const Frame& frame) { return this->updateFrame(&frame); }
+
+	private:
+		/**
+		* Refreshes the class state, calling the device's updateState()
+		* without going through the virtual table
+		*
+		* @param f pointer to the frame being updated, or nullptr
+		* @returns 'true' if device state changed, 'false' otherwise
+		*/
+		bool updateFrame(const Frame* f) {
+			const bool connected = this->pollConnection(f);
+
+			this->setFrame(f);
+			const bool changed = this->Device::updateState(connected);
+			this->setFrame(nullptr);
+
+			return changed;
+		}
+	};
+
+
+	/**
+	* @brief Updates peripherals at their own rates
+	*
+	* Each peripheral is registered with a target update rate, and on each
+	* call to update() the scheduler runs whichever peripherals are due.
+	* Due peripherals are run slowest first, so that the fastest (most
+	* latency sensitive) ones are sampled last, right before the sketch
+	* sends its report.
+	*
+	* The scheduler also tracks how late each peripheral was run compared
+	* to its deadline (jitter), and how many deadlines were missed entirely.
+	* The clock is read as each peripheral starts, so the jitter includes
+	* the time spent updating the peripherals run before it.
+	*
+	* @code{.cpp}
+	* SimRacing::Scheduler scheduler;
+	*
+	* void setup() {
+	*     scheduler.add(handbrake, 100);  // Hz
+	*     scheduler.add(shifter, 500);
+	*     scheduler.add(pedals, 1000);
+	* }
+	*
+	* void loop() {
+	*     if (scheduler.update()) {
+	*         // send report
+	*     }
+	* }
+	* @endcode
+	*
+	* @note The connection detection is polled at the same rate as the rest
+	*       of the peripheral. To take it out of the loop entirely, use
+	*       Peripheral::setDetectInterrupt().
+	*/
+	class Scheduler {
+	public:
+		static const uint8_t MaxTasks = 4;  ///< Maximum number of peripherals that can be scheduled
+
+		/**
+		* @brief Timing statistics for a scheduled peripheral
+		*/
+		struct Stats {
+			unsigned long runs;       ///< the number of times the peripheral was updated
+			unsigned long missed;     ///< the number of deadlines missed entirely
+			unsigned long lastJitter; ///< how late the last update started, in us
+			unsigned long maxJitter;  ///< the latest an update has started, in us
+		};
+
+		/**
+		* Class constructor
+		*/
+		Scheduler();
+
+		/**
+		* Registers a peripheral to be updated at a target rate
+		*
+		* @param peripheral the peripheral to update
+		* @param rate       the target update rate, in Hz. 0 updates the
+		*                   peripheral on every call to update().
+		*
+		* @return 'true' if the peripheral was added (or its rate was
+		*         changed), 'false' if the scheduler is full
+		*/
+		bool add(Peripheral& peripheral, unsigned long rate);
+
+		/**
+		* Updates all of the peripherals that are due, starting a new frame
+		*
+		* @return 'true' if any of the updated peripherals changed state
+		*/
+		bool update();
+
+		/**
+		* Updates all of the peripherals that are due, using a shared frame
+		*
+		* @param frame the frame being updated, after calling Frame::tick()
+		*
+		* @return 'true' if any of the updated peripherals changed state
+		*/
+		bool update(const Frame& frame);
+
+		/**
+		* Retrieves the timing statistics for a peripheral
+		*
+		* @param peripheral the scheduled peripheral
+		* @return the peripheral's statistics, all zero if not scheduled
+		*/
+		Stats getStats(const Peripheral& peripheral) const;
+
+		/**
+		* Resets the timing statistics for all peripherals. This does not
+		* affect when the peripherals are next due.
+		*/
+		void resetStats();
+
+		/**
+		* Retrieves the scheduler's own frame, used by update()
+		*
+		* @return the frame used for the last update()
+		*/
+		const Frame& getFrame() const { return this->frame; }
+
+	private:
+		/**
+		* @brief A peripheral registered with the scheduler
+		*/
+		struct Task {
+			Peripheral* peripheral;  ///< the peripheral to update
+			unsigned long interval;  ///< the time between updates, in us
+			unsigned long deadline;  ///< the time the next update is due, in us
+			bool started;            ///< whether the peripheral has been updated, and the deadline is set
+			Stats stats;             ///< the timing statistics for the peripheral
+		};
+
+		Task tasks[MaxTasks];  ///< Scheduled peripherals, sorted slowest first
+		uint8_t numTasks;      ///< Number of scheduled peripherals
+		Frame frame;           ///< Frame used when the sketch doesn't provide one
 	};
 
 
@@ -372,7 +1630,7 @@ namespace SimRacing {
 		* @param pedal the pedal to retrieve position for
 		* @return the axis position, buffered
 		*/
-		int getPositionRaw(PedalID pedal) const;
+		AnalogValue getPositionRaw(PedalID pedal) const;
 
 		/**
 		* Checks if a given pedal is present in the class.
@@ -392,17 +1650,62 @@ namespace SimRacing {
 		/**
 		* Checks whether the current pedal positions have changed since the last update.
 		*
-		* @return 'true' if position has changed, 'false' otherwise
+		* @return 'true' if position has changed, 'false' otherwise
+		*/
+		bool positionChanged() const { return changed; }
+
+		/**
+		* Calibrate a pedal's min/max values for rescaling.
+		* 
+		* @param pedal the pedal to set the calibration of
+		* @param cal the calibration data to set
+		*/
+		void setCalibration(PedalID pedal, AnalogInput::Calibration cal);
+
+		/**
+		* Sets the filter used to smooth a pedal's readings.
+		*
+		* @param pedal    the pedal to set the filter for
+		* @param type     the filter type to use
+		* @param strength the amount of filtering to apply, or 0 for default
+		* @param speed    the filter speed coefficient, or 0 for default
+		*
+		* @see AnalogInput::setFilter()
+		*/
+		void setFilter(PedalID pedal, AnalogInput::FilterType type, uint8_t strength = 0, uint8_t speed = 0);
+
+		/**
+		* Sets the number of bits of extra resolution to read for a pedal,
+		* by oversampling and decimation. The pedal's calibration is rescaled
+		* to match.
+		*
+		* @param pedal the pedal to set the oversampling for
+		* @param bits  the number of extra bits of resolution, 0-3
+		*
+		* @see AnalogInput::setOversampling()
+		*/
+		void setOversampling(PedalID pedal, uint8_t bits);
+
+		/**
+		* Sets a deadband for a pedal's change detection, so that noise does
+		* not set the positionChanged() flag.
+		*
+		* @param pedal    the pedal to set the deadband for
+		* @param counts   the deadband, in ADC counts. 0 reports every change.
+		* @param adaptive whether to widen the deadband by the measured noise
+		*
+		* @see AnalogInput::setDeadband()
 		*/
-		bool positionChanged() const { return changed; }
+		void setDeadband(PedalID pedal, uint8_t counts, bool adaptive = false);
 
 		/**
-		* Calibrate a pedal's min/max values for rescaling.
-		* 
-		* @param pedal the pedal to set the calibration of
-		* @param cal the calibration data to set
+		* Retrieves the number of a pedal's position changes that were not
+		* reported because they were within the deadband
+		*
+		* @param pedal the pedal to get the count for
+		* @return the number of suppressed changes
 		*/
-		void setCalibration(PedalID pedal, AnalogInput::Calibration cal);
+		unsigned long getSuppressedCount(PedalID pedal) const;
 
 		/**
 		* Runs an interactive calibration tool using the serial interface.
@@ -587,24 +1890,126 @@ namespace SimRacing {
 		*/
 		Gear getGearMax() { return MaxGear; }
 
+		static const uint8_t MaxEvents = 8;  ///< Number of gear changes held in the event queue
+
+		/**
+		* @brief A change from one gear to another
+		*/
+		struct GearEvent {
+			Gear from;           ///< the gear before the change
+			Gear to;             ///< the gear after the change
+			unsigned long time;  ///< time of the change, in milliseconds
+		};
+
+		/**
+		* Retrieves the oldest gear change from the event queue.
+		*
+		* Every gear change is added to the queue as it happens, so gears
+		* that are only held between two reads of the queue are not lost.
+		* If the queue is full, the oldest change is dropped to make room.
+		*
+		* The time of each change is the frame time if the shifter is
+		* updated with a Frame, or millis() otherwise.
+		*
+		* @param event the struct to store the gear change in
+		*
+		* @return 'true' if there was a change in the queue, 'false' if
+		*         the queue was empty
+		*/
+		bool getEvent(GearEvent& event);
+
+		/**
+		* Gets the number of gear changes waiting in the event queue.
+		*
+		* @return the number of gear changes in the queue
+		*/
+		uint8_t getEventCount() const { return this->eventCount; }
+
+		/**
+		* Gets the number of gear changes that were dropped because the
+		* event queue was full.
+		*
+		* @return the number of dropped gear changes
+		*/
+		unsigned long getDroppedEvents() const { return this->eventsDropped; }
+
+		/**
+		* Empties the event queue.
+		*/
+		void clearEvents();
+
+		/**
+		* @brief Timing statistics for shifts between gears
+		*
+		* A shift is a change from one gear to another, through neutral.
+		* The time of a shift is measured from leaving the first gear to
+		* engaging the next, which is the time spent in neutral. A direct
+		* change from one gear to another has a shift time of 0.
+		*/
+		struct ShiftStats {
+			unsigned long shifts;    ///< number of shifts measured
+			unsigned long last;      ///< time of the last shift, in milliseconds
+			unsigned long fastest;   ///< shortest shift time, in milliseconds
+			unsigned long slowest;   ///< longest shift time, in milliseconds
+			unsigned long total;     ///< sum of all shift times, in milliseconds, for the average
+		};
+
+		/**
+		* Retrieves the timing statistics for shifts between gears.
+		*
+		* @return the shift timing statistics
+		*/
+		const ShiftStats& getShiftStats() const { return this->shiftStats; }
+
+		/**
+		* Resets the shift timing statistics.
+		*/
+		void resetShiftStats();
+
 	protected:
 		/**
 		* Changes the currently set gear, internally
 		* 
 		* This function sanitizes the newly selected gear with MinGear / MaxGear,
 		* and handles caching the previous value for checking if the gear has
-		* changed.
+		* changed. Every change is added to the event queue.
 		* 
 		* @param gear the new gear value to set
 		*/
 		void setGear(Gear gear);
 
+		/**
+		* Discards the shift in progress, if any, so that the next gear
+		* engaged is not measured as a shift. For when the gear is forced
+		* to neutral rather than shifted there, such as when the shifter
+		* is disconnected.
+		*/
+		void cancelShift() { this->shifting = false; }
+
 	private:
+		/**
+		* Adds a gear change to the event queue and updates the
+		* shift timing statistics
+		*
+		* @param from the gear before the change
+		* @param to   the gear after the change
+		*/
+		void recordChange(Gear from, Gear to);
+
 		const Gear MinGear;  ///< the lowest selectable gear
 		const Gear MaxGear;  ///< the highest selectable gear
 
 		Gear currentGear;    ///< index of the current gear
 		Gear previousGear;   ///< index of the last selected gear
+
+		GearEvent events[MaxEvents];  ///< Ring buffer of gear changes
+		uint8_t eventHead;            ///< Index of the oldest gear change in the buffer
+		uint8_t eventCount;           ///< Number of gear changes in the buffer
+		unsigned long eventsDropped;  ///< Number of gear changes dropped from a full buffer
+
+		ShiftStats shiftStats;        ///< Timing statistics for shifts
+		unsigned long neutralTime;    ///< Time that neutral was entered from a gear
+		bool shifting;                ///< Whether neutral was entered from a gear
 	};
 
 
@@ -623,10 +2028,13 @@ namespace SimRacing {
 		* @param pinRev  the digital input pin for the 'reverse' button
 		* 
 		* @note With the way the class is designed, the lowest possible gear is
-		*       -1 (reverse), and the highest possible gear is 6. Setting the
-		*       arguments lower/higher than this will have no effect. Setting
-		*       the arguments within this range will limit to those gears,
-		*       and selecting gears out of range will result in neutral.
+		*       -1 (reverse), and the highest possible gear is the highest in
+		*       the gate map (6 with the default map). Setting the arguments
+		*       lower/higher than this will have no effect. Setting the
+		*       arguments within this range will limit to those gears, and
+		*       selecting gears out of range will result in neutral.
+		*
+		* @see setGateMap()
 		*/
 		AnalogShifter(
 			Gear gearMin, Gear gearMax,
@@ -649,7 +2057,7 @@ namespace SimRacing {
 		/** @copydoc AnalogInput::getPositionRaw()
 		*   @param ax the axis to get the position of
 		*/
-		int getPositionRaw(Axis ax) const;
+		AnalogValue getPositionRaw(Axis ax) const;
 
 		/**
 		* Checks the current state of the "reverse" button at the bottom
@@ -664,8 +2072,8 @@ namespace SimRacing {
 		* @brief Simple struct to store X/Y coordinates for the calibration function
 		*/
 		struct GearPosition {
-			int x;  ///< X coordinate of the gear position from the ADC
-			int y;  ///< Y coordinate of the gear position from the ADC
+			AnalogValue x;  ///< X coordinate of the gear position from the ADC
+			AnalogValue y;  ///< Y coordinate of the gear position from the ADC
 		};
 
 		/**
@@ -694,11 +2102,104 @@ namespace SimRacing {
 		* @param edgeOffset   distance from neutral on X to select the side gears
 		*                     rather than the center gears (as a percentage of
 		*                     distance from neutral to X max, 0-1)
+		*
+		* @note This also resets the gate map to the default, DefaultGateMap
 		*/
 		void setCalibration(
 			GearPosition neutral,
 			GearPosition g1, GearPosition g2, GearPosition g3, GearPosition g4, GearPosition g5, GearPosition g6,
-			float engagePoint = CalEngagementPoint, float releasePoint = CalReleasePoint, float edgeOffset = CalEdgeOffset);
+			Fraction engagePoint = CalEngagementPoint, Fraction releasePoint = CalReleasePoint, Fraction edgeOffset = CalEdgeOffset);
+
+		static const uint8_t MaxColumns = 5;  ///< Maximum number of columns in a gate map
+
+		/**
+		* @brief How the reverse slot of a gate map is engaged
+		*/
+		enum ReverseMode : uint8_t {
+			ReverseSlot = 0,  ///< reverse has its own slot, and is engaged like any other gear
+			ReverseLockout,   ///< reverse has its own slot, but is only engaged while the reverse button is pressed
+			ReverseShared,    ///< reverse shares its slot with a forward gear, and is engaged by pressing the reverse button (Logitech)
+		};
+
+		/**
+		* @brief Layout of the gears in an H-pattern gate
+		*
+		* The gate is made of columns from left to right, each with a top
+		* slot (Y max) and a bottom slot (Y min). Each slot holds the gear
+		* it selects: 1 and up for the forward gears, -1 for reverse, or 0
+		* if the slot is unused.
+		*
+		* For example, a 7-speed gate with reverse at the bottom right
+		* behind a lockout:
+		* `{ 4, { 1, 3, 5, 7 }, { 2, 4, 6, -1 }, AnalogShifter::ReverseLockout }`
+		*/
+		struct GateMap {
+			uint8_t columns;          ///< number of columns in the gate, 2 to MaxColumns
+			Gear top[MaxColumns];     ///< gear in the top slot of each column, from left to right
+			Gear bottom[MaxColumns];  ///< gear in the bottom slot of each column, from left to right
+			ReverseMode reverseMode;  ///< how reverse is engaged in its slot
+			Gear sharedGear;          ///< forward gear in the reverse slot, for ReverseShared
+		};
+
+		/**
+		* The default gate map: six gears in three columns, with reverse
+		* sharing the slot of 6th gear (Logitech)
+		*/
+		static const GateMap DefaultGateMap;
+
+		/**
+		* Sets the layout of the gears in the gate.
+		*
+		* The map is compiled into lookup tables, so the cost of each update
+		* is the same regardless of the number of gears. If the number of
+		* columns changes the column edges are spaced evenly across the X
+		* axis until the shifter is calibrated for the new map.
+		*
+		* Each forward gear may only appear once, every column needs at least
+		* one gear, and both rows need at least one gear. Gears outside of
+		* the range set in the constructor will read as neutral.
+		*
+		* @param map the gate map to use
+		*
+		* @return 'true' if the map is valid and was set, 'false' otherwise
+		*
+		* @see setCalibration(GearPosition, const GearPosition*, GearPosition, Fraction, Fraction)
+		*/
+		bool setGateMap(const GateMap& map);
+
+		/**
+		* Gets the layout of the gears in the gate.
+		*
+		* @return the current gate map
+		*/
+		const GateMap& getGateMap() const { return this->gate; }
+
+		/**
+		* Calibrate the gear shifter for the current gate map.
+		*
+		* The column edges are set halfway between the average X positions
+		* of the gears in each column.
+		*
+		* @param neutral the X/Y position of the shifter in neutral
+		* @param gears   array of the X/Y positions of the forward gears,
+		*                starting with 1st gear. Must have an entry for
+		*                every forward gear in the gate map.
+		* @param reverse the X/Y position of the shifter in reverse. Unused
+		*                if reverse shares its slot with a forward gear.
+		* @param engagePoint  distance from neutral on Y to register a gear as
+		*                     being engaged (as a percentage of distance from
+		*                     neutral to Y max, 0-1)
+		* @param releasePoint distance from neutral on Y to go back into neutral
+		*                     from an engaged gear (as a percentage of distance
+		*                     from neutral to Y max, 0-1)
+		*
+		* @note The 6-speed setCalibration() function resets the gate map to
+		*       the default. Set any custom map *before* calibrating with
+		*       this function.
+		*/
+		void setCalibration(
+			GearPosition neutral, const GearPosition* gears, GearPosition reverse,
+			Fraction engagePoint = CalEngagementPoint, Fraction releasePoint = CalReleasePoint);
 
 		/**
 		* Runs an interactive calibration tool using the serial interface.
@@ -708,6 +2209,77 @@ namespace SimRacing {
 		*/
 		void serialCalibration(Stream& iface = Serial);
 
+		/**
+		* Sets the filter used to smooth the readings of both axes.
+		*
+		* @param type     the filter type to use
+		* @param strength the amount of filtering to apply, or 0 for default
+		* @param speed    the filter speed coefficient, or 0 for default
+		*
+		* @see AnalogInput::setFilter()
+		*/
+		void setFilter(AnalogInput::FilterType type, uint8_t strength = 0, uint8_t speed = 0);
+
+		/**
+		* Sets up predictive gear engagement.
+		*
+		* When enabled, the Y axis velocity is estimated from successive
+		* updates. If the stick is past the release point, moving toward
+		* the gate, and is on track to cross the engagement point within
+		* the lookahead, the gear is engaged early rather than waiting
+		* for the stick to reach the engagement point.
+		*
+		* If the stick turns back before the engagement point confirms the
+		* prediction, or doesn't reach it within the lookahead, the gear is
+		* rolled back to neutral.
+		*
+		* Both the lookahead and the speed are per update, so they should
+		* be tuned for the rate that update() is called.
+		*
+		* Prediction is off by default, because it trades latency for false
+		* engagements. Replaying a scripted session at 1 kHz (see
+		* extras/host/bench), a lookahead of 2 engaged gears 2.4 ms sooner
+		* on average, but also engaged a gear on 4% of the shifts that were
+		* abandoned between the release and engagement points. A lookahead
+		* of 5 won 6.6 ms for 22%, and 10 won 12.6 ms for 67%. The default
+		* speed is just above the reading noise, so it only rejects a stick
+		* at rest; raising it to 8 at 1 kHz halved the false engagements
+		* for a fraction of a millisecond.
+		*
+		* @param lookahead the number of updates to look ahead, or 0 to
+		*                  disable prediction
+		* @param minSpeed  the minimum speed toward the gate to predict
+		*                  a gear, in normalized counts per update, or 0
+		*                  for default
+		*/
+		void setPrediction(uint8_t lookahead, AnalogValue minSpeed = 0);
+
+		/**
+		* Gets the number of updates to look ahead for predictive gear
+		* engagement.
+		*
+		* @return the prediction lookahead, or 0 if disabled
+		*/
+		uint8_t getPrediction() const { return this->predictLookahead; }
+
+		/**
+		* Gets the number of gears that have been engaged early by
+		* prediction.
+		*
+		* @return the number of predicted gears
+		*/
+		unsigned long getPredictedCount() const { return this->predictions; }
+
+		/**
+		* Gets the number of predicted gears that were rolled back because
+		* the stick didn't reach the engagement point.
+		*
+		* Compare to getPredictedCount() for the false engagement rate.
+		*
+		* @return the number of rolled back gears
+		*/
+		unsigned long getRollbackCount() const { return this->rollbacks; }
+
 	protected:
 		/** @copydoc Peripheral::updateState(bool) */
 		virtual bool updateState(bool connected);
@@ -724,105 +2296,461 @@ namespace SimRacing {
 		*/
 		virtual bool readReverseButton();
 
+		/**
+		* Flags for the Y axis gear zones, set if the position is past each
+		* of the calibrated thresholds
+		*/
+		enum GearZone : uint8_t {
+			PastOddRelease  = 1 << 0,  ///< past the threshold to release an odd gear
+			PastEvenRelease = 1 << 1,  ///< past the threshold to release an even gear
+			PastOddTrigger  = 1 << 2,  ///< past the threshold to engage an odd gear
+			PastEvenTrigger = 1 << 3,  ///< past the threshold to engage an even gear
+		};
+
+		/**
+		* Flags for the row of each gear in the gate map
+		*/
+		enum GateRow : uint8_t {
+			RowTop    = 1 << 0,  ///< the gear is in the top row (odd on the default map)
+			RowBottom = 1 << 1,  ///< the gear is in the bottom row (even on the default map)
+		};
+
+		/**
+		* Classifies an X axis position into its column of gears by comparing
+		* it against the calibrated column edges
+		*
+		* @param x the normalized X axis position
+		* @returns the column, from 0 (left) to the number of columns - 1
+		*/
+		uint8_t classifyColumn(AnalogValue x) const;
+
+		/**
+		* Classifies a Y axis position into its gear zones by comparing it
+		* against the calibration
+		*
+		* @param y the normalized Y axis position
+		* @returns the GearZone flags for the position
+		*/
+		uint8_t classifyZone(AnalogValue y) const;
+
+		/**
+		* Predicts whether the Y axis is about to cross a trigger threshold,
+		* by projecting its position forward with its velocity
+		*
+		* @param y        the normalized Y axis position
+		* @param velocity the Y axis velocity, in counts per update
+		* @param zone     the GearZone flags for the position
+		* @returns the GearZone trigger flag for the predicted gear, or 0
+		*/
+		uint8_t predictZone(AnalogValue y, AnalogValue velocity, uint8_t zone) const;
+
+		/**
+		* Builds the lookup grid from the calibration. Cells that straddle
+		* a threshold are flagged to fall back to classifyColumn() and
+		* classifyZone(), so the lookup always matches the comparisons.
+		*/
+		void buildGrid();
+
+		static const uint8_t GridBits = 4;                ///< Number of bits for the grid cells on each axis
+		static const uint8_t GridSize = 1 << GridBits;    ///< Number of grid cells on each axis
+
+		static const uint8_t GridZoneMask = 0x1F;         ///< Mask for the Y axis GearZone flags of a cell
+		static const uint8_t GridZoneSplit = 0x10;        ///< Y axis flag for a cell that straddles a threshold
+		static const uint8_t GridColumnShift = 5;         ///< Bit offset for the X axis column of a cell
+		static const uint8_t GridColumnSplit = 0x07;      ///< X axis column for a cell that straddles an edge
+
+		/**
+		* Lookup grid for both axes, packed to one byte per cell to save
+		* memory. The X axis gear column is in the top three bits and the
+		* Y axis GearZone flags are in the bottom five.
+		*/
+		uint8_t grid[GridSize];
+
+		/**
+		* Sets the axis calibration and the Y thresholds, shared by both
+		* calibration functions
+		*
+		* @param neutral      the raw X/Y position of the shifter in neutral
+		* @param xMin         the raw X position of the leftmost column
+		* @param xMax         the raw X position of the rightmost column
+		* @param yMin         the raw Y position of the bottom row
+		* @param yMax         the raw Y position of the top row
+		* @param engagePoint  engagement point, as a percentage (0-1)
+		* @param releasePoint release point, as a percentage (0-1)
+		*
+		* @returns the neutral position, normalized
+		*/
+		GearPosition calibrateAxes(
+			GearPosition neutral,
+			AnalogValue xMin, AnalogValue xMax, AnalogValue yMin, AnalogValue yMax,
+			Fraction engagePoint, Fraction releasePoint);
+
+		/**
+		* Normalizes a raw position using an axis' calibration, without
+		* changing the axis' current position
+		*
+		* @param ax  the axis to use
+		* @param raw the raw position
+		*
+		* @returns the normalized position
+		*/
+		AnalogValue normalizePosition(Axis ax, AnalogValue raw);
+
+		static const uint8_t MaxGateGears = MaxColumns * 2;  ///< Highest forward gear in a gate map
+
+		GateMap gate;                            ///< The layout of the gears in the gate
+		uint8_t gearRows[MaxGateGears + 2];      ///< GateRow flags for each gear, indexed from reverse (-1)
+		uint8_t reverseColumn;                   ///< Column with the reverse slot, or MaxColumns if none
+
 		/**
 		* Distance from neutral on Y to register a gear as
 		* being engaged (as a percentage of distance from
 		* neutral to Y max, 0-1). Used for calibration.
 		*/
-		static const float CalEngagementPoint; 
+		static const Fraction CalEngagementPoint; 
 
 		/**
 		* Distance from neutral on Y to go back into neutral 
 		* from an engaged gear (as a percentage of distance
 		* from neutral to Y max, 0-1). Used for calibration.
 		*/
-		static const float CalReleasePoint;
+		static const Fraction CalReleasePoint;
 
 		/**
 		* Distance from neutral on X to select the side gears
 		* rather than the center gears (as a percentage of
 		* distance from neutral to X max, 0-1). Used for calibration.
 		*/
-		static const float CalEdgeOffset;
+		static const Fraction CalEdgeOffset;
 
 		/*** Internal calibration struct */
 		struct Calibration {
-			int    neutralX;  ///< X-axis neutral position, for reset on disconnect
-			int    neutralY;  ///< Y-axis neutral position, for reset on disconnect
-			int  oddTrigger;  ///< Odd gear threshold to set the input 'on' if disengaged
-			int  oddRelease;  ///< Odd gear threshold to set the input 'off' if engaged
-			int evenTrigger;  ///< Even gear threshold to set the input 'on' if disengaged
-			int evenRelease;  ///< Even gear threshold to set the input 'off' if engaged
-			int    leftEdge;  ///< Threshold for the lower (left) gears, 1 + 2
-			int   rightEdge;  ///< Threshold for the higher (right) gears, 5 + 6
+			AnalogValue    neutralX;  ///< X-axis neutral position, for reset on disconnect
+			AnalogValue    neutralY;  ///< Y-axis neutral position, for reset on disconnect
+			AnalogValue  oddTrigger;  ///< Odd gear threshold to set the input 'on' if disengaged
+			AnalogValue  oddRelease;  ///< Odd gear threshold to set the input 'off' if engaged
+			AnalogValue evenTrigger;  ///< Even gear threshold to set the input 'on' if disengaged
+			AnalogValue evenRelease;  ///< Even gear threshold to set the input 'off' if engaged
+			AnalogValue edges[MaxColumns - 1];  ///< Lowest X position of each column past the first
 		} calibration;
 
 		AnalogInput analogAxis[2];  ///< Axis data for X and Y
 		PinNum pinReverse;          ///< The pin for the reverse gear button
+		FastPin fastReverse;        ///< Fast I/O access for the reverse gear button
 		bool reverseState;          ///< Buffered value for the state of the reverse gear button
+
+		uint8_t predictLookahead;   ///< Number of updates to look ahead for predicted gears, 0 to disable
+		AnalogValue predictSpeed;   ///< Minimum speed toward the gate to predict a gear, per update
+		AnalogValue lastY;          ///< Normalized Y position from the previous update, for the velocity
+		bool predicted;             ///< Whether the current gear was predicted and not yet confirmed
+		uint8_t predictAge;         ///< Number of updates since the current gear was predicted
+		unsigned long predictions;  ///< Number of gears engaged by prediction
+		unsigned long rollbacks;    ///< Number of predicted gears that were rolled back
+	};
+
+	/// @} Shifters
+
+
+	/**
+	* @brief Interface with analog handbrakes that use hall effect sensors
+	*/
+	class Handbrake : public Peripheral {
+	public:
+		/**
+		* Class constructor
+		*
+		* @param pinAx analog pin number for the handbrake axis
+		*/
+		Handbrake(PinNum pinAx);
+
+		/**
+		* Initializes the pin for reading from the handbrake.
+		*/
+		virtual void begin();
+
+		/**
+		* Retrieves the buffered position for the handbrake axis, rescaled to a
+		* nominal range using the calibration values.
+		*
+		* By default this is rescaled to an integer percentage (0 - 100)
+		*
+		* @param rMin the minimum output value
+		* @param rMax the maximum output value
+		*
+		* @return the handbrake position, buffered and rescaled
+		*/
+		long getPosition(long rMin = 0, long rMax = 100) const;
+
+		/**
+		* Retrieves the buffered position for the handbrake, ignoring the
+		* calibration data.
+		*
+		* @return the handbrake position, buffered
+		*/
+		AnalogValue getPositionRaw() const;
+
+		/**
+		* Checks whether the handbrake's position has changed since the last update.
+		*
+		* @return 'true' if the position has changed, 'false' otherwise
+		*/
+		bool positionChanged() const { return this->changed; }
+
+		/// @copydoc AnalogInput::setCalibration()
+		void setCalibration(AnalogInput::Calibration newCal);
+
+		/// @copydoc AnalogShifter::serialCalibration()
+		void serialCalibration(Stream& iface = Serial);
+
+		/**
+		* Sets the filter used to smooth the handbrake's readings.
+		*
+		* @param type     the filter type to use
+		* @param strength the amount of filtering to apply, or 0 for default
+		* @param speed    the filter speed coefficient, or 0 for default
+		*
+		* @see AnalogInput::setFilter()
+		*/
+		void setFilter(AnalogInput::FilterType type, uint8_t strength = 0, uint8_t speed = 0);
+
+		/**
+		* Sets the number of bits of extra resolution to read for the
+		* handbrake, by oversampling and decimation. The calibration is
+		* rescaled to match.
+		*
+		* @param bits the number of extra bits of resolution, 0-3
+		*
+		* @see AnalogInput::setOversampling()
+		*/
+		void setOversampling(uint8_t bits);
+
+		/**
+		* Sets a deadband for the handbrake's change detection, so that noise
+		* does not set the positionChanged() flag.
+		*
+		* @param counts   the deadband, in ADC counts. 0 reports every change.
+		* @param adaptive whether to widen the deadband by the measured noise
+		*
+		* @see AnalogInput::setDeadband()
+		*/
+		void setDeadband(uint8_t counts, bool adaptive = false);
+
+		/**
+		* Retrieves the number of the handbrake's position changes that were
+		* not reported because they were within the deadband
+		*
+		* @return the number of suppressed changes
+		*/
+		unsigned long getSuppressedCount() const { return this->analogAxis.getSuppressedCount(); }
+
+	protected:
+		/** @copydoc Peripheral::updateState(bool) */
+		virtual bool updateState(bool connected);
+
+	private:
+		AnalogInput analogAxis;      ///< axis data for the handbrake's position
+		bool changed;                ///< whether the handbrake position has changed since the previous update
 	};
 
-	/// @} Shifters
 
+	/**
+	* @brief Interface with a chain of parallel-in, serial-out shift registers
+	*        (such as the 74HC165) used as digital inputs, e.g. a button box
+	*
+	* Inputs are numbered from LSB, with input 0 being the last bit shifted
+	* out of the chain. The states are stored as a packed bitmap, MSB-first,
+	* in the order the bytes are read.
+	*
+	* @tparam Bits the number of inputs in the chain, e.g. 24 for three registers
+	*/
+	template<uint8_t Bits>
+	class ShiftRegisterInput : public Peripheral {
+	public:
+		static const uint8_t NumInputs = Bits;             ///< Number of inputs in the chain
+		static const uint8_t NumBytes  = (Bits + 7) / 8;   ///< Number of bytes read from the chain
+
+		static const uint8_t MaxDebounce = VerticalCounter<uint8_t>::MaxSamples;  ///< Maximum number of updates for debouncing
+
+		/**
+		* Class constructor
+		*
+		* @param pinLatch  the pin to pulse to latch data
+		* @param pinClock  the pin to pulse as a clock
+		* @param pinData   the pin to read data from
+		* @param pinDetect the pin used to detect whether the inputs are connected.
+		*                  This pin must be pulled high when the device is connected.
+		*/
+		ShiftRegisterInput(PinNum pinLatch, PinNum pinClock, PinNum pinData, PinNum pinDetect = UnusedPin)
+			:
+			bus(pinLatch, pinClock, pinData),
+			detectObj(pinDetect, false)  // active high
+		{
+			this->setDetectPtr(&this->detectObj);
+			for (uint8_t i = 0; i < NumBytes; ++i) {
+				this->states[i] = this->changes[i] = 0x00;
+			}
+		}
+
+		/**
+		* Initializes the hardware pins for reading from the registers.
+		*/
+		virtual void begin() {
+			this->bus.setPinModes(0);  // disabled, until connected
+			update();
+		}
+
+		/**
+		* Checks if a given input is pressed
+		*
+		* @param index the input to check, numbered from LSB
+		* @returns 'true' if the input is pressed, 'false' otherwise
+		*/
+		bool getButton(uint8_t index) const {
+			if (index >= Bits) return false;
+			return this->states[byteIndex(index)] & bitMask(index);
+		}
+
+		/**
+		* Checks whether an input has changed between updates
+		*
+		* @param index the input to check, numbered from LSB
+		* @returns 'true' if the input's state has changed, 'false' otherwise
+		*/
+		bool getButtonChanged(uint8_t index) const {
+			if (index >= Bits) return false;
+			return this->changes[byteIndex(index)] & bitMask(index);
+		}
 
-	/**
-	* @brief Interface with analog handbrakes that use hall effect sensors
-	*/
-	class Handbrake : public Peripheral {
-	public:
 		/**
-		* Class constructor
+		* Checks if any of the inputs have changed since the last update
 		*
-		* @param pinAx analog pin number for the handbrake axis
+		* @returns 'true' if any input's state has changed, 'false' otherwise
 		*/
-		Handbrake(PinNum pinAx);
+		bool buttonsChanged() const {
+			uint8_t any = 0x00;
+			for (uint8_t i = 0; i < NumBytes; ++i) {
+				any |= this->changes[i];
+			}
+			return any != 0x00;
+		}
 
 		/**
-		* Initializes the pin for reading from the handbrake.
+		* Retrieves the packed input states, MSB-first
+		*
+		* @returns pointer to the NumBytes of input states
 		*/
-		virtual void begin();
+		const uint8_t* getStates() const { return this->states; }
 
 		/**
-		* Retrieves the buffered position for the handbrake axis, rescaled to a
-		* nominal range using the calibration values.
+		* Retrieves the packed mask of inputs that changed on the last
+		* update, MSB-first
 		*
-		* By default this is rescaled to an integer percentage (0 - 100)
+		* @returns pointer to the NumBytes of changed inputs
+		*/
+		const uint8_t* getChanges() const { return this->changes; }
+
+		/**
+		* Sets the number of updates in a row that all inputs need to read
+		* the same state before their state changes
 		*
-		* @param rMin the minimum output value
-		* @param rMax the maximum output value
+		* @param samples the number of updates, 1 (no debouncing) to
+		*                MaxDebounce
 		*
-		* @return the handbrake position, buffered and rescaled
+		* @see LogitechShifterG27::setDebounce()
 		*/
-		long getPosition(long rMin = 0, long rMax = 100) const;
+		void setDebounce(uint8_t samples) {
+			for (uint8_t i = 0; i < NumBytes; ++i) {
+				this->debouncer[i].setLimit(0xFF, samples);
+			}
+		}
 
 		/**
-		* Retrieves the buffered position for the handbrake, ignoring the
-		* calibration data.
+		* Sets the number of updates in a row that an input needs to read
+		* the same state before its state changes
 		*
-		* @return the handbrake position, buffered
+		* @param index   the input to set, numbered from LSB
+		* @param samples the number of updates, 1 (no debouncing) to
+		*                MaxDebounce
 		*/
-		int getPositionRaw() const;
+		void setDebounce(uint8_t index, uint8_t samples) {
+			if (index >= Bits) return;
+			this->debouncer[byteIndex(index)].setLimit(bitMask(index), samples);
+		}
 
 		/**
-		* Checks whether the handbrake's position has changed since the last update.
+		* Gets the number of updates in a row that an input needs to read
+		* the same state before its state changes
 		*
-		* @return 'true' if the position has changed, 'false' otherwise
+		* @param index the input to check, numbered from LSB
+		* @return the number of updates, 1 (no debouncing) to MaxDebounce
 		*/
-		bool positionChanged() const { return this->changed; }
+		uint8_t getDebounce(uint8_t index) const {
+			if (index >= Bits) return 1;
+			return this->debouncer[byteIndex(index)].getLimit(index % 8);
+		}
 
-		/// @copydoc AnalogInput::setCalibration()
-		void setCalibration(AnalogInput::Calibration newCal);
+		/// @copydoc ShiftRegisterBus::setHardwareSPI()
+		bool setHardwareSPI(bool enabled = true) { return this->bus.setHardwareSPI(enabled); }
 
-		/// @copydoc AnalogShifter::serialCalibration()
-		void serialCalibration(Stream& iface = Serial);
+		/// @copydoc ShiftRegisterBus::usingHardwareSPI()
+		bool usingHardwareSPI() const { return this->bus.usingHardwareSPI(); }
 
 	protected:
 		/** @copydoc Peripheral::updateState(bool) */
-		virtual bool updateState(bool connected);
+		virtual bool updateState(bool connected) {
+			uint8_t data[NumBytes];
+
+			if (connected) {
+				if (!this->bus.isEnabled()) {
+					this->bus.setPinModes(1);
+				}
+				this->bus.read(data, NumBytes);
+
+				// bits past the end of the chain are not inputs
+				data[0] &= FirstMask;
+			}
+			else {
+				if (this->bus.isEnabled()) {
+					this->bus.setPinModes(0);
+				}
+				for (uint8_t i = 0; i < NumBytes; ++i) {
+					data[i] = 0x00;
+				}
+			}
+
+			uint8_t any = 0x00;
+			for (uint8_t i = 0; i < NumBytes; ++i) {
+				// the inputs are released immediately on disconnect,
+				// so only debounce while connected
+				if (!connected) this->debouncer[i].reset();
+				else if (this->debouncer[i].enabled()) {
+					data[i] = this->debouncer[i].update(data[i], this->states[i]);
+				}
+
+				this->changes[i] = data[i] ^ this->states[i];
+				this->states[i] = data[i];
+				any |= this->changes[i];
+			}
+
+			return any != 0x00;
+		}
 
 	private:
-		AnalogInput analogAxis;      ///< axis data for the handbrake's position
-		bool changed;                ///< whether the handbrake position has changed since the previous update
+		/** Mask of the valid bits in the first byte read, which holds the highest inputs */
+		static const uint8_t FirstMask = (Bits % 8) ? (uint8_t) ((1 << (Bits % 8)) - 1) : 0xFF;
+
+		/** Gets the index of the byte holding an input, MSB-first */
+		static uint8_t byteIndex(uint8_t index) { return (NumBytes - 1) - (index / 8); }
+
+		/** Gets the mask for an input within its byte */
+		static uint8_t bitMask(uint8_t index) { return 1 << (index % 8); }
+
+		ShiftRegisterBus bus;                         ///< shift register interface
+		DeviceConnection detectObj;                   ///< detector instance for checking if the inputs are connected
+
+		uint8_t states[NumBytes];                     ///< packed input states, MSB-first
+		uint8_t changes[NumBytes];                    ///< packed mask of inputs that changed on the last update, MSB-first
+		VerticalCounter<uint8_t> debouncer[NumBytes]; ///< debounce counters for each byte of inputs
 	};
 
 
@@ -965,6 +2893,19 @@ namespace SimRacing {
 			DPAD_UP           = 0,   ///< Top button of the directional pad
 		};
 
+		/**
+		* @brief Enumeration of the shifter hardware that can be connected
+		*
+		* The Driving Force shifter (G29/G920/G923) uses the same connector,
+		* but has no shift registers. Its data pin carries the state of the
+		* reverse button instead.
+		*/
+		enum DeviceType : uint8_t {
+			DEVICE_UNKNOWN       = 0,  ///< Not yet detected, or not connected
+			DEVICE_G27           = 1,  ///< G27 or G25 shifter, with shift registers
+			DEVICE_DRIVING_FORCE = 2,  ///< Driving Force shifter, reverse button only
+		};
+
 		/**
 		* Class constructor
 		*
@@ -1024,6 +2965,144 @@ namespace SimRacing {
 		*/
 		bool buttonsChanged() const;
 
+		static const uint8_t MaxButtonEvents = 128;  ///< Maximum number of button presses and releases held in the event queue
+
+		/**
+		* @brief A button being pressed or released
+		*/
+		struct ButtonEvent {
+			Button button;       ///< the button that changed
+			bool pressed;        ///< 'true' if the button was pressed, 'false' if released
+			unsigned long time;  ///< time of the change, in milliseconds
+		};
+
+		/**
+		* Sets the buffer for the button event queue, enabling the queue.
+		*
+		* The queue is off by default so that it doesn't cost any memory
+		* unless it's used. The buffer is provided by the sketch and must
+		* outlive the shifter, e.g.:
+		*
+		* @code{.cpp}
+		* LogitechShifterG27::ButtonEvent events[16];
+		* shifter.setButtonEventBuffer(events, 16);
+		* @endcode
+		*
+		* Setting the buffer empties the queue.
+		*
+		* @param buffer the array to store button changes in, or 'nullptr'
+		*               to disable the queue
+		* @param size   the number of changes the array holds. This is
+		*               rounded down to a power of two, up to MaxButtonEvents.
+		*/
+		void setButtonEventBuffer(ButtonEvent* buffer, uint8_t size);
+
+		/**
+		* Retrieves the oldest button press or release from the event queue.
+		*
+		* Every change of the buttons is added to the queue as the buttons
+		* are read, so presses that are released before the next check of
+		* the buttons are not lost, and the queue can be drained without
+		* checking every button. If the queue is full new changes are
+		* dropped, so the queue can be read safely while an interrupt
+		* updates the shifter.
+		*
+		* The time of each change is the frame time if the shifter is
+		* updated with a Frame, or millis() otherwise.
+		*
+		* @note The queue must be enabled with setButtonEventBuffer()
+		*
+		* @param event the struct to store the button change in
+		*
+		* @return 'true' if there was a change in the queue, 'false' if
+		*         the queue was empty or disabled
+		*/
+		bool getButtonEvent(ButtonEvent& event);
+
+		/**
+		* Gets the number of button changes waiting in the event queue.
+		*
+		* @return the number of button changes in the queue
+		*/
+		uint8_t getButtonEventCount() const;
+
+		/**
+		* Gets the number of button changes that were dropped because
+		* the event queue was full.
+		*
+		* @return the number of dropped button changes
+		*/
+		unsigned long getDroppedButtonEvents() const;
+
+		/**
+		* Empties the button event queue.
+		*/
+		void clearButtonEvents();
+
+		static const uint8_t MaxDebounce = VerticalCounter<uint16_t>::MaxSamples;  ///< Maximum number of updates to debounce a button over
+
+		/**
+		* Sets the debounce time for all of the buttons.
+		*
+		* A debounced button only changes state once it has read the new
+		* state for this many updates in a row. All 16 buttons are debounced
+		* together using vertical counters, so this only adds a few word
+		* operations to each update.
+		*
+		* @param samples the number of updates in a row to change state,
+		*                up to MaxDebounce. 0 or 1 disables debouncing.
+		*/
+		void setDebounce(uint8_t samples);
+
+		/**
+		* Sets the debounce time for a single button.
+		*
+		* @param button  the button to set the debounce time for
+		* @param samples the number of updates in a row to change state,
+		*                up to MaxDebounce. 0 or 1 disables debouncing.
+		*
+		* @see setDebounce(uint8_t)
+		*/
+		void setDebounce(Button button, uint8_t samples);
+
+		/**
+		* Gets the debounce time for a single button.
+		*
+		* @param button the button to get the debounce time for
+		*
+		* @return the number of updates in a row for the button to change state
+		*/
+		uint8_t getDebounce(Button button) const;
+
+		/**
+		* Sets which buttons are used by the application, so that the shift
+		* registers are only clocked as far as they need to be.
+		*
+		* The data is shifted out MSB-first, from bit 15 down to bit 0, so
+		* the read stops once it reaches the lowest used bit. Buttons below
+		* that bit are not read and always report as released. The reverse
+		* button (and the sequential button on the G25) is always read, as
+		* the shifter itself depends on it.
+		*
+		* Buttons that are held when they stop being read are released on
+		* the next update, the same as if they were let go. This sets the
+		* changed flag and adds release events to the queue (if enabled).
+		*
+		* @param mask packed word of the buttons to read, where each button
+		*             is set by (1 << Button). All buttons are read by default.
+		*/
+		void setUsedButtons(uint16_t mask);
+
+		/**
+		* Gets the mask of buttons that are read from the shift registers
+		*
+		* @return packed word of the buttons read, including the buttons the
+		*         shifter requires
+		*
+		* @see setUsedButtons()
+		*/
+		uint16_t getUsedButtons() const { return this->usedButtons | this->requiredButtons; }
+
 		/**
 		* Sets the state of the shifter's power LED
 		*
@@ -1047,10 +3126,62 @@ namespace SimRacing {
 		*/
 		bool getPowerLED() const { return this->ledState; }
 
+		/**
+		* Gets the type of shifter that is connected
+		*
+		* The type is detected from the shift register data once per
+		* connection. The Driving Force reads as all ones when its reverse
+		* button is pressed. Any other non-zero read must come from a
+		* shifter with shift registers. Until either happens the type is
+		* unknown, and the shift registers are read in full.
+		*
+		* Once the Driving Force is detected, only its data pin is read.
+		* The type is detected again when the shifter is reconnected.
+		*
+		* @returns the detected shifter type
+		*/
+		DeviceType getDeviceType() const { return this->deviceType; }
+
+		/**
+		* Reads the shift registers using the hardware SPI peripheral instead
+		* of bit-banging the clock and data pins.
+		*
+		* This is only possible if the clock pin is the board's SPI clock
+		* (SCK) pin and the data pin is the board's SPI input (MISO) pin, as
+		* on the Sim Racing Shifter Shield v2 for the G27. If the pins do not
+		* match, the shifter keeps using the bit-banged reads.
+		*
+		* @note If the power LED is connected to the SPI output (MOSI) pin,
+		*       the commanded LED state is maintained by the data sent
+		*       during the read.
+		*
+		* @param enabled 'true' to use hardware SPI, 'false' to bit-bang
+		* @returns 'true' if hardware SPI is in use, 'false' otherwise
+		*/
+		bool setHardwareSPI(bool enabled = true);
+
+		/**
+		* Checks whether the shift registers are read using hardware SPI
+		*
+		* @returns 'true' if hardware SPI is in use, 'false' otherwise
+		* @see setHardwareSPI(bool)
+		*/
+		bool usingHardwareSPI() const { return this->shiftRegisters.usingHardwareSPI(); }
+
 	protected:
 		/** @copydoc Peripheral::updateState(bool) */
 		virtual bool updateState(bool connected);
 
+		/**
+		* Adds buttons that are always read from the shift registers,
+		* regardless of the buttons used by the application
+		*
+		* @param mask packed word of the buttons that are required
+		*
+		* @see setUsedButtons()
+		*/
+		void addRequiredButtons(uint16_t mask);
+
 	private:
 		/**
 		* Extracts a button value from a given data word
@@ -1068,7 +3199,7 @@ namespace SimRacing {
 
 		/**
 		* Store the current button data for reference and replace it with
-		* a new value
+		* a new value, and add any changes to the event queue
 		* 
 		* @param newStates The new button states to store
 		*/
@@ -1092,21 +3223,35 @@ namespace SimRacing {
 		/** @copydoc AnalogShifter::readReverseButton() */
 		virtual bool readReverseButton();
 
-		// Pins for the shift register interface
-		PinNum pinLatch;             ///< Pin to pulse to latch data, DE-9 pin 3
-		PinNum pinClock;             ///< Pin to pulse as a clock, DE-9 pin 1
-		PinNum pinData;              ///< Pin to use for reading data, DE-9 pin 2
+		// Shift register interface, latch on DE-9 pin 3, clock on DE-9 pin 1, data on DE-9 pin 2
+		ShiftRegisterBus shiftRegisters;  ///< Reads the button data from the shift registers
 
 		// Generic I/O pins
 		PinNum pinLed;               ///< Pin to light the power LED, DE-9 pin 5
+		FastPin fastLed;             ///< Fast I/O access for the power LED pin
 
 		// I/O state
-		bool pinModesSet;            ///< Flag for whether the output pins are enabled / driven
 		bool ledState;               ///< Commanded state of the power LED output, DE-9 pin 5
+		DeviceType deviceType;       ///< Type of shifter detected on this connection
+
+		// Partial reads
+		uint16_t requiredButtons;    ///< buttons that are always read, as they're needed by the shifter
+		uint16_t usedButtons;        ///< buttons that are read for the application
+		uint8_t readLength;          ///< number of bits to clock out of the shift registers, MSB-first
 
 		// Button states
 		uint16_t buttonStates;       ///< the state of the buttons, as a packed word (where 0 = unpressed and 1 = pressed)
 		uint16_t previousButtons;    ///< the previous state of the buttons, for comparison
+
+		// Button event queue. The indices count up and wrap, so the difference is the
+		// number of events. Only cacheButtons() moves the tail, and only the reads move the head.
+		ButtonEvent* buttonEvents;                  ///< Ring buffer of button changes, provided by the sketch
+		uint8_t buttonEventSize;                    ///< Number of button changes the buffer holds, a power of two
+		volatile uint8_t buttonEventHead;           ///< Count of button changes read from the buffer
+		volatile uint8_t buttonEventTail;           ///< Count of button changes written to the buffer
+		volatile unsigned long buttonEventsDropped; ///< Number of button changes dropped from a full buffer
+
+		VerticalCounter<uint16_t> debouncer;  ///< Debounces the button states
 	};
 
 	/**
@@ -1182,9 +3327,9 @@ namespace SimRacing {
 		*                     from an engaged gear (as a percentage of distance
 		*                     from neutral to Y max, 0-1)
 		*/
-		void setCalibrationSequential(int neutral, int up, int down,
-			float engagePoint  = LogitechShifterG25::CalEngagementPoint,
-			float releasePoint = LogitechShifterG25::CalReleasePoint
+		void setCalibrationSequential(AnalogValue neutral, AnalogValue up, AnalogValue down,
+			Fraction engagePoint  = LogitechShifterG25::CalEngagementPoint,
+			Fraction releasePoint = LogitechShifterG25::CalReleasePoint
 		);
 
 		/** @copydoc AnalogShifter::serialCalibration(Stream&) */
@@ -1200,28 +3345,285 @@ namespace SimRacing {
 		* being engaged (as a percentage of distance from
 		* neutral to Y max, 0-1). Used for calibration.
 		*/
-		static const float CalEngagementPoint; 
+		static const Fraction CalEngagementPoint; 
 
 		/**
 		* Distance from neutral on Y to go back into neutral 
 		* from an engaged gear (as a percentage of distance
 		* from neutral to Y max, 0-1). Used for calibration.
 		*/
-		static const float CalReleasePoint;
+		static const Fraction CalReleasePoint;
 
 		bool   sequentialProcess;  ///< Flag to indicate whether we are processing sequential shifts
 		int8_t sequentialState;    ///< Tri-state flag for the shift direction. 1 (Up), 0 (Neutral), -1 (Down).
 
 		/*** Internal calibration struct */
 		struct SequentialCalibration {
-			int   upTrigger;  ///< Threshold to set the sequential shift as 'up'
-			int   upRelease;  ///< Threshold to clear the 'up' sequential shift
-			int downTrigger;  ///< Threshold to set the sequential shift as 'down'
-			int downRelease;  ///< Threshold to clear the 'down' sequential shift
+			AnalogValue   upTrigger;  ///< Threshold to set the sequential shift as 'up'
+			AnalogValue   upRelease;  ///< Threshold to clear the 'up' sequential shift
+			AnalogValue downTrigger;  ///< Threshold to set the sequential shift as 'down'
+			AnalogValue downRelease;  ///< Threshold to clear the 'down' sequential shift
 		} seqCalibration;
 	};
 
 
+#if SIM_RACING_TRACE || defined(SIM_RACING_DOXYGEN)
+	/**
+	* @brief Types of raw input that can be traced
+	*/
+	enum class TraceSource : uint8_t {
+		Analog = 0,          ///< an ADC reading from AnalogInput::read(), after oversampling
+		Pin = 1,             ///< a connection pin level from DeviceConnection, before inversion
+		ShiftRegisters = 2,  ///< the button data read by LogitechShifterG27, MSB-first
+	};
+
+	/**
+	* @brief Interface for observing, and optionally replacing, the raw
+	*        inputs read by the library
+	*
+	* Requires SIM_RACING_TRACE. The hook is called every time one of the
+	* inputs is read, in the same order the reads are made, and whatever it
+	* returns is used in place of the value from the hardware.
+	*
+	* The hook is also called by DeviceConnection in interrupt mode, from
+	* the ISR. Use polling while tracing.
+	*
+	* @see setTraceHook()
+	*/
+	class TraceHook {
+	public:
+		/** Class destructor */
+		virtual ~TraceHook() {}
+
+		/**
+		* Called with each raw input value read from the hardware
+		*
+		* @param source the type of input
+		* @param pin    the pin the input was read from. For shift
+		*               registers this is the data pin.
+		* @param value  the value read from the hardware
+		*
+		* @return the value for the library to use
+		*/
+		virtual uint16_t onRead(TraceSource source, PinNum pin, uint16_t value) = 0;
+	};
+
+	/**
+	* Sets the hook to call on every raw input read
+	*
+	* @param hook the hook to use, or nullptr for none
+	*/
+	void setTraceHook(TraceHook* hook);
+
+	/**
+	* Gets the hook called on every raw input read
+	*
+	* @return the current hook, or nullptr for none
+	*/
+	TraceHook* getTraceHook();
+
+	/**
+	* @brief Compact binary trace format for the raw inputs
+	*
+	* The trace starts with the header "SRT" and a version byte, followed by
+	* one record per read. Each input read is a "channel", identified by its
+	* source and pin, and numbered in the order they first appear.
+	*
+	* Each record starts with a tag byte:
+	*   * bits 0-4: the channel number. 31 instead defines the next
+	*     channel, and is followed by the source and the pin (one byte each).
+	*   * bit 5: set if the time since the channel was last read differs
+	*     from the time between its previous two reads. If set, the
+	*     difference follows as a signed varint, in microseconds.
+	*   * bits 6-7: the change in value since the channel was last read.
+	*     0 is no change, 1 is +1, 2 is -1, and 3 means the change follows
+	*     the time as a signed varint.
+	*
+	* Varints are 7 bits per byte, least significant first, with the high
+	* bit set on every byte but the last. Signed values are zigzag encoded
+	* (0, -1, 1, -2, ...) so that small negative values stay small.
+	*
+	* A read at a steady rate that changes by one count or less takes one
+	* byte.
+	*/
+	namespace TraceFormat {
+		const uint8_t Version = 1;           ///< version of the format, written in the header
+		const uint8_t HeaderSize = 4;        ///< bytes in the header
+		const uint8_t MaxChannels = 8;       ///< maximum number of channels in a trace, for the encoder and decoder
+		const uint8_t ChannelMask = 0x1F;    ///< bits of the tag holding the channel number
+		const uint8_t ChannelDefine = 0x1F;  ///< channel number marking a channel definition
+		const uint8_t TimeFlag = 0x20;       ///< tag bit marking that a time adjustment follows
+		const uint8_t ValueShift = 6;        ///< position of the value code in the tag
+
+		/// Value codes, for the top bits of the tag
+		enum ValueCode : uint8_t {
+			ValueSame = 0,   ///< the value is unchanged
+			ValueUp = 1,     ///< the value is one higher
+			ValueDown = 2,   ///< the value is one lower
+			ValueDelta = 3,  ///< the change in value follows
+		};
+
+		/**
+		* @brief Running state of one channel, shared by the encoder and decoder
+		*/
+		struct Channel {
+			TraceSource source;  ///< the type of input
+			PinNum pin;          ///< the pin the input is read from
+			uint16_t value;      ///< the last value read
+			uint32_t time;       ///< the time of the last read, in microseconds
+			uint32_t interval;   ///< the time between the last two reads, in microseconds
+		};
+	}
+
+	/**
+	* @brief Records the raw inputs to a binary trace as they're read
+	*
+	* Each read is timestamped with micros() and written to the output in
+	* the TraceFormat encoding. Reads are passed through unchanged.
+	*
+	* @code{.cpp}
+	* SimRacing::TraceRecorder recorder(Serial);
+	*
+	* void setup() {
+	*     Serial.begin(115200);
+	*     recorder.begin();
+	*     SimRacing::setTraceHook(&recorder);
+	*     pedals.begin();
+	* }
+	* @endcode
+	*
+	* @see TraceReader
+	*/
+	class TraceRecorder : public TraceHook {
+	public:
+		/**
+		* Class constructor
+		*
+		* @param out the output to write the trace to
+		*/
+		TraceRecorder(Print& out);
+
+		/**
+		* Starts a new trace, writing the header
+		*/
+		void begin();
+
+		/**
+		* Records a read at the current time
+		*
+		* @copydoc TraceHook::onRead()
+		*/
+		uint16_t onRead(TraceSource source, PinNum pin, uint16_t value) override;
+
+		/**
+		* Records a read
+		*
+		* @param source the type of input
+		* @param pin    the pin the input was read from
+		* @param value  the value read
+		* @param time   the time of the read, in microseconds
+		*
+		* @return 'true' if the read was recorded, 'false' if there are
+		*         too many channels
+		*/
+		bool record(TraceSource source, PinNum pin, uint16_t value, uint32_t time);
+
+		/**
+		* Gets the number of bytes written to the output since begin()
+		*
+		* @return the size of the trace, in bytes
+		*/
+		unsigned long getSize() const { return this->size; }
+
+		/**
+		* Gets the number of reads recorded since begin()
+		*
+		* @return the number of records in the trace
+		*/
+		unsigned long getCount() const { return this->count; }
+
+	private:
+		/**
+		* Writes a varint to the output
+		*
+		* @param value the value to write
+		*/
+		void writeVarint(uint32_t value);
+
+		Print& out;             ///< the output to write the trace to
+		TraceFormat::Channel channels[TraceFormat::MaxChannels];  ///< the state of each channel
+		uint8_t numChannels;    ///< the number of channels defined
+		unsigned long size;     ///< the number of bytes written
+		unsigned long count;    ///< the number of records written
+	};
+
+	/**
+	* @brief Decodes a binary trace written by TraceRecorder
+	*/
+	class TraceReader {
+	public:
+		/**
+		* @brief One read from the trace
+		*/
+		struct Record {
+			TraceSource source;  ///< the type of input
+			PinNum pin;          ///< the pin the input was read from
+			uint16_t value;      ///< the value read
+			uint32_t time;       ///< the time of the read, in microseconds
+		};
+
+		/**
+		* Class constructor
+		*
+		* @param in the input to read the trace from
+		*/
+		TraceReader(Stream& in);
+
+		/**
+		* Starts reading a trace, checking the header
+		*
+		* @return 'true' if the header is valid, 'false' otherwise
+		*/
+		bool begin();
+
+		/**
+		* Reads the next record from the trace
+		*
+		* @param rec the record to fill
+		*
+		* @return 'true' if a record was read, 'false' at the end of the
+		*         trace or if the trace is invalid
+		*
+		* @see isValid()
+		*/
+		bool read(Record& rec);
+
+		/**
+		* Checks whether the trace has been valid so far. If not, read()
+		* stopped at an error rather than the end of the trace.
+		*
+		* @return 'true' if the trace is valid, 'false' otherwise
+		*/
+		bool isValid() const { return this->valid; }
+
+	private:
+		/**
+		* Reads a varint from the input
+		*
+		* @param value the value to fill
+		*
+		* @return 'true' if the varint was read, 'false' otherwise
+		*/
+		bool readVarint(uint32_t& value);
+
+		Stream& in;             ///< the input to read the trace from
+		TraceFormat::Channel channels[TraceFormat::MaxChannels];  ///< the state of each channel
+		uint8_t numChannels;    ///< the number of channels defined
+		bool valid;             ///< whether the trace has been valid so far
+	};
+#endif
+
+
 #if defined(__AVR_ATmega32U4__) || defined(SIM_RACING_DOXYGEN)
 	/**
 	* Create an object for use with one of the Sim Racing Shields, designed
@@ -1303,6 +3705,7 @@ namespace SimRacing {
 	LogitechShifterG25 CreateShieldObject<LogitechShifterG25, 2>();
 #endif
 
+}  // end configuration namespace
 }  // end SimRacing namespace
 
 #endif